@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace CrazyDave {
+
+/**
+ * AccessBuffer collects page hits for the replacer without a lock, in the style of Caffeine's read buffer.
+ *
+ * Hits are appended to one of ACCESS_BUFFER_STRIPES small rings, picked by the thread id so that threads mostly
+ * write to different cache lines. A producer claims a position with a compare-and-swap on the ring's write counter
+ * and then publishes the entry. When the ring is full the hit is dropped: the replacer only needs an approximate
+ * picture of recency, and a hot page hit often enough still shows up. The buffer pool manager drains the rings into
+ * the replacer in batches whenever it holds its latch anyway, and when a ring fills up. Draining is single consumer.
+ */
+class AccessBuffer {
+ public:
+  AccessBuffer() = default;
+  AccessBuffer(const AccessBuffer &) = delete;
+  auto operator=(const AccessBuffer &) -> AccessBuffer & = delete;
+
+  /**
+   * @brief Record a hit on a frame.
+   * @return true if the stripe written to is full and should be drained
+   */
+  auto Record(frame_id_t frame_id, AccessType access_type) -> bool {
+    static thread_local const size_t stripe_of_thread = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    auto &stripe = stripes_[stripe_of_thread % ACCESS_BUFFER_STRIPES];
+    uint32_t tail = stripe.writes_.load(std::memory_order_relaxed);
+    uint32_t head = stripe.reads_.load(std::memory_order_acquire);
+    if (tail - head >= static_cast<uint32_t>(ACCESS_BUFFER_SIZE)) {
+      return true;
+    }
+    if (!stripe.writes_.compare_exchange_strong(tail, tail + 1, std::memory_order_relaxed)) {
+      // Lost the slot to another thread on this stripe, the hit is dropped rather than retried.
+      return false;
+    }
+    stripe.entries_[tail % ACCESS_BUFFER_SIZE].store(Encode(frame_id, access_type), std::memory_order_release);
+    return tail + 1 - head >= static_cast<uint32_t>(ACCESS_BUFFER_SIZE);
+  }
+
+  /**
+   * @brief Hand every published hit to sink, in the order of each stripe. Must not run concurrently with itself.
+   * @param sink called with the frame id and access type of each hit
+   */
+  template <class Sink>
+  void Drain(Sink &&sink) {
+    for (auto &stripe : stripes_) {
+      uint32_t head = stripe.reads_.load(std::memory_order_relaxed);
+      uint32_t tail = stripe.writes_.load(std::memory_order_acquire);
+      for (; head != tail; ++head) {
+        uint64_t entry = stripe.entries_[head % ACCESS_BUFFER_SIZE].exchange(0, std::memory_order_acquire);
+        if (entry == 0) {
+          break;  // claimed but not published yet, pick it up next time
+        }
+        sink(static_cast<frame_id_t>((entry >> 8) - 1), static_cast<AccessType>(entry & 0xff));
+      }
+      stripe.reads_.store(head, std::memory_order_release);
+    }
+  }
+
+ private:
+  static auto Encode(frame_id_t frame_id, AccessType access_type) -> uint64_t {
+    return (static_cast<uint64_t>(frame_id) + 1) << 8 | static_cast<uint64_t>(access_type);
+  }
+
+  struct alignas(CACHE_LINE_SIZE) Stripe {
+    std::atomic<uint32_t> writes_{0};
+    std::atomic<uint32_t> reads_{0};
+    /** Encoded hits, 0 for a slot not published yet. */
+    std::atomic<uint64_t> entries_[ACCESS_BUFFER_SIZE]{};
+  };
+
+  Stripe stripes_[ACCESS_BUFFER_STRIPES];
+};
+
+}  // namespace CrazyDave
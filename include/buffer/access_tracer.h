@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include "buffer/replacer.h"
+#include "common/config.h"
+#include "data_structures/vector.h"
+
+namespace CrazyDave {
+
+/** What happened to a page in a trace record. A prefetch read brings a page in without being an access itself. */
+enum class TraceEvent : uint8_t { Miss = 0, Hit, Delete, Prefetch };
+
+/**
+ * One page access of a trace. A trace file is TRACE_MAGIC followed by TraceRecords in the order the buffer pool saw
+ * the accesses, in the byte order of the machine that wrote it.
+ */
+struct TraceRecord {
+  page_id_t page_id_;
+  uint8_t access_type_;  // AccessType
+  TraceEvent event_;
+  uint16_t file_id_{0};  // file of the page in a buffer pool shared by several files
+};
+
+static constexpr uint64_t TRACE_MAGIC = 0x3130454341525442;  // "BTRACE01"
+
+/**
+ * AccessTracer logs the page accesses of a buffer pool to a binary trace file, which the replacer simulator in
+ * tools/ replays against other pool sizes and replacement policies.
+ *
+ * Records are collected in a buffer and written out TRACE_BUFFER_SIZE at a time. Record() is safe to call from any
+ * thread; while no trace is open it costs a relaxed load.
+ */
+class AccessTracer {
+ public:
+  AccessTracer() = default;
+  ~AccessTracer() { Stop(); }
+
+  /**
+   * @brief Start logging to a file, replacing a trace in progress.
+   * @return false if the file cannot be opened
+   */
+  auto Start(const std::string &path) -> bool;
+
+  /** @brief Write out the buffered records and close the trace. Does nothing if no trace is open. */
+  void Stop();
+
+  auto IsEnabled() const -> bool { return enabled_.load(std::memory_order_relaxed); }
+
+  void Record(page_id_t page_id, AccessType access_type, TraceEvent event, file_id_t file_id = 0) {
+    if (IsEnabled()) {
+      Append({page_id, static_cast<uint8_t>(access_type), event, static_cast<uint16_t>(file_id)});
+    }
+  }
+
+  /** @return number of records logged by the current or last trace */
+  auto GetRecordCount() const -> size_t { return record_count_.load(std::memory_order_relaxed); }
+
+ private:
+  void Append(const TraceRecord &record);
+  /** Write out the buffered records. Must be called with latch_ held. */
+  void FlushBuffer();
+
+  std::atomic<bool> enabled_{false};
+  std::atomic<size_t> record_count_{0};
+  std::mutex latch_;
+  std::ofstream file_;
+  vector<TraceRecord> buffer_;
+};
+
+}  // namespace CrazyDave
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+#include "data_structures/linked_hashmap.h"
+#include "data_structures/vector.h"
+
+namespace CrazyDave {
+
+/**
+ * ARCReplacer implements the Adaptive Replacement Cache policy of Megiddo and Modha.
+ *
+ * Resident frames are kept in two LRU lists: T1 holds pages accessed once since they were read, T2 pages accessed
+ * again. Evicted pages are remembered by page key in the ghost lists B1 and B2. A miss on a page found in B1 means T1
+ * was too small and grows its target size, a miss found in B2 shrinks it; such pages come back straight into T2.
+ * Eviction takes the least recently used evictable frame of T1 while T1 is above its target, of T2 otherwise.
+ *
+ * A scan touches a page once, so scans cycle through T1 and leave T2 alone. Scan accesses to a page already
+ * tracked do not promote it either. Ghosts need the page keys passed to RecordAccess(); without them ARC degrades to
+ * a fixed split between T1 and T2.
+ */
+class ARCReplacer : public Replacer {
+ public:
+  /** @param num_frames the maximum number of frames the replacer will be required to store */
+  explicit ARCReplacer(size_t num_frames);
+
+  ~ARCReplacer() override = default;
+
+  auto Evict(frame_id_t *frame_id, const std::function<auto(frame_id_t)->bool> &evictable = {}) -> bool override;
+
+  void RecordAccess(frame_id_t frame_id, AccessType access_type = AccessType::Unknown,
+                    page_key_t page_key = INVALID_PAGE_KEY) override;
+
+  void SetEvictable(frame_id_t frame_id, bool set_evictable) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  auto Size() -> size_t override { return curr_size_; }
+
+  void SetCapacity(size_t num_frames) override;
+
+  void GetHotFrames(vector<frame_id_t> *frames) override;
+
+  /** @return the current target size of T1 */
+  auto GetTarget() const -> size_t { return target_; }
+
+ private:
+  static constexpr int T1 = 0;
+  static constexpr int T2 = 1;
+  static constexpr int NONE = 2;
+
+  /** Intrusive doubly linked list node of a frame, lists run from the least to the most recently used frame. */
+  struct Entry {
+    frame_id_t prev_{-1};
+    frame_id_t next_{-1};
+    int list_{NONE};
+    bool is_evictable_{false};
+    page_key_t page_key_{INVALID_PAGE_KEY};
+  };
+
+  void Link(frame_id_t frame_id, int list);
+  void Unlink(frame_id_t frame_id);
+
+  /** @return the least recently used frame of list passing the filter, or -1 */
+  auto FindVictim(int list, const std::function<auto(frame_id_t)->bool> &evictable) -> frame_id_t;
+
+  /** Remember an evicted page in a ghost list. */
+  void AddGhost(int list, page_key_t page_key);
+
+  /** Drop the oldest ghosts until the ghost lists fit the sizes ARC allows. */
+  void TrimGhosts();
+
+  vector<Entry> entries_;
+  frame_id_t head_[2]{-1, -1};
+  frame_id_t tail_[2]{-1, -1};
+  size_t size_[2]{0, 0};
+  /** B1 and B2, in insertion order so that begin() is the oldest ghost. */
+  linked_hashmap<page_key_t, bool> ghosts_[2];
+  size_t capacity_;
+  /** Target size of T1, adapted on ghost hits. */
+  size_t target_{0};
+  size_t curr_size_{0};
+};
+
+}  // namespace CrazyDave
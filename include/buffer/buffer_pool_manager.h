@@ -1,28 +1,86 @@
 #pragma once
 
-#include "buffer/lru_k_replacer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iosfwd>
+#include <mutex>
+#include <thread>
+
+#include "buffer/access_buffer.h"
+#include "buffer/access_tracer.h"
+#include "buffer/epoch_manager.h"
+#include "buffer/replacer.h"
 #include "common/config.h"
-#include "data_structures/linked_hashmap.h"
+#include "common/striped_counter.h"
+#include "data_structures/flat_hashmap.h"
 #include "data_structures/list.h"
+#include "storage/disk/concurrent_queue.h"
 #include "storage/disk/my_disk_manager.h"
 #include "storage/page/page.h"
 #include "storage/page/page_guard.h"
 
 namespace CrazyDave {
 
+/** Snapshot of the counters of a buffer pool, its replacer and its disk manager, see BufferPoolManager::GetStats(). */
+struct BufferPoolStats {
+  size_t pool_size_{0};
+  size_t free_frames_{0};
+  size_t dirty_pages_{0};
+  size_t hits_{0};            // fetches of a page already in the pool, including swizzled_hits_
+  size_t misses_{0};          // fetches that read the page from disk
+  size_t swizzled_hits_{0};   // hits served through a swizzled reference without the latch
+  size_t new_pages_{0};
+  size_t deleted_pages_{0};
+  size_t fetch_failures_{0};  // fetches and new pages that returned nullptr: no frame to be had or a failed read
+  size_t frame_waits_{0};     // fetches and new pages that waited for a frame to be unpinned
+  size_t frame_wait_us_{0};   // time spent in those waits
+  size_t foreground_evictions_{0};
+  size_t background_evictions_{0};
+  size_t sync_write_backs_{0};  // dirty victims written back in the foreground
+  size_t flushed_pages_{0};     // pages written back by the background flusher
+  size_t prefetched_pages_{0};
+  ReplacerStats replacer_;
+  DiskStats disk_;
+
+  auto HitRatio() const -> double {
+    return hits_ + misses_ == 0 ? 0 : static_cast<double>(hits_) / static_cast<double>(hits_ + misses_);
+  }
+
+  /** @brief Print the counters as text, one per line. */
+  void Dump(std::ostream &os) const;
+};
+
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
+ *
+ * One buffer pool can serve up to MAX_FILES files, each with its own disk manager, so that several indexes share
+ * their frames and memory goes to whichever of them is hot. Files are added with OpenFile() and a page is identified
+ * by its file id and its page id. Every method taking a page id takes the file id as its last argument, which
+ * defaults to file 0, the only file of a pool created for a single file.
  */
 class BufferPoolManager {
  public:
   /**
-   * @brief Creates a new BufferPoolManager.
+   * @brief Creates a new BufferPoolManager serving a single file, which gets file id 0.
+   * @param name the name of the file
    * @param pool_size the size of the buffer pool
-   * @param disk_manager the disk manager
    * @param replacer_k the lookback constant k for the LRU-K replacer
-   * @param log_manager the log manager (for testing only: nullptr = disable logging). Please ignore this for P1.
+   * @param direct_io bypass the kernel page cache with O_DIRECT, so that the buffer pool is the only page cache
+   * @param replacer_type the replacement policy
    */
-  BufferPoolManager(const std::string &name,size_t pool_size,  size_t replacer_k = LRUK_REPLACER_K);
+  BufferPoolManager(const std::string &name, size_t pool_size, size_t replacer_k = LRUK_REPLACER_K,
+                    bool direct_io = false, ReplacerType replacer_type = ReplacerType::LRUK);
+
+  /**
+   * @brief Creates a new BufferPoolManager without files, to be shared by the files added through OpenFile().
+   * @param pool_size the size of the buffer pool
+   * @param replacer_k the lookback constant k for the LRU-K replacer
+   * @param direct_io open every file with O_DIRECT
+   * @param replacer_type the replacement policy
+   */
+  explicit BufferPoolManager(size_t pool_size, size_t replacer_k = LRUK_REPLACER_K, bool direct_io = false,
+                             ReplacerType replacer_type = ReplacerType::LRUK);
 
   /**
    * @brief Destroy an existing BufferPoolManager.
@@ -35,24 +93,104 @@ class BufferPoolManager {
   /** @brief Return the pointer to all the pages in the buffer pool. */
   auto GetPages() -> Page * { return pages_; }
 
+  /**
+   * @brief Grow or shrink the buffer pool while it is in use.
+   *
+   * The frames live in address space reserved for max(pool_size, MAX_BUFFER_POOL_SIZE) frames up front, so frames
+   * never move and a resize only commits or releases memory at the end of the pool. Growing adds the new frames to
+   * the free list. Shrinking releases the last frames RESIZE_CHUNK_SIZE at a time: their pages are written back if
+   * dirty and dropped, and the memory of each chunk is handed back to the system. latch_ is released between chunks
+   * and while waiting for pinned frames, so fetches go on meanwhile.
+   *
+   * @param pool_size the new number of frames
+   * @param timeout how long shrinking waits for a frame to be unpinned before giving up
+   * @return false if pool_size is out of range or shrinking timed out, the pool then keeps the chunks released so far
+   */
+  auto Resize(size_t pool_size, std::chrono::milliseconds timeout = std::chrono::milliseconds(RESIZE_TIMEOUT_MS))
+      -> bool;
+
+  /** @return the largest size the pool can grow to */
+  auto GetMaxPoolSize() const -> size_t { return max_pool_size_; }
+
+  /**
+   * @brief Set how long NewPage() and a fetch missing the pool wait for a frame while every frame is pinned.
+   *
+   * Waiters sleep until a frame is unpinned or freed and then retry, so many threads can share a pool smaller than
+   * the pages they pin at once, at the cost of some latency. The time spent waiting is counted in GetStats().
+   *
+   * @param timeout how long to wait before giving up with nullptr, 0 to give up right away
+   */
+  void SetFrameWaitTimeout(std::chrono::milliseconds timeout) {
+    std::scoped_lock lock(latch_);
+    frame_wait_timeout_ = timeout;
+  }
+
+  /** @return true if the frame arena is backed by explicit (hugetlbfs) huge pages only, no transparent ones */
+  auto IsHugeTlbArena() const -> bool { return hugetlb_arena_; }
+
+  /**
+   * @brief Add a file to the pool, files stay open until the pool is destroyed.
+   *
+   * If the hot pages of the file were saved by SaveHotPages(), the hottest of them that fit in the free frames are
+   * read back in the background, in page id order and WARM_UP_BATCH at a time through the prefetcher, so that the
+   * pool starts out warm.
+   *
+   * @param name the name of the file, opening a file twice returns the same id
+   * @return the id of the file, or INVALID_FILE_ID if the pool already serves MAX_FILES files
+   */
+  auto OpenFile(const std::string &name) -> file_id_t;
+
+  /**
+   * @brief Save the ids of the pages in the pool, for each file hottest first as ranked by the replacer, so that
+   * the next pool opening the file warms up with them. The destructor saves them too, calling it now and then
+   * keeps the list useful after a crash.
+   */
+  void SaveHotPages();
+
+  /** @return number of files served by the pool */
+  auto GetFileCount() -> size_t {
+    std::scoped_lock lock(latch_);
+    return file_count_;
+  }
+
+  /**
+   * @brief Cap the number of frames the pages of a file may take.
+   *
+   * A file at its quota replaces one of its own pages on a miss instead of taking a free frame or evicting a page of
+   * another file, so a single index scanning through its pages cannot flush the others out of the pool. A fetch
+   * fails when every page of the file is pinned. A file over its quota, because the quota was lowered, gives the
+   * extra frames back as its pages are evicted.
+   *
+   * @param file_id the file
+   * @param frames the most frames the file may take, 0 for no limit (the default)
+   */
+  void SetFileQuota(file_id_t file_id, size_t frames);
+
+  /** @return number of frames holding pages of the file */
+  auto GetFileFrameCount(file_id_t file_id) -> size_t {
+    std::scoped_lock lock(latch_);
+    return file_frames_[file_id];
+  }
+
   /**
    * TODO(P1): Add implementation
    *
    * @brief Create a new page in the buffer pool. Set page_id to the new page's id, or nullptr if all frames
-   * are currently in use and not evictable (in another word, pinned).
+   * are currently in use and not evictable (in another word, pinned) until the frame wait timeout, see
+   * SetFrameWaitTimeout().
    *
    * You should pick the replacement frame from either the free list or the replacer (always find from the free list
    * first), and then call the AllocatePage() method to get a new page id. If the replacement frame has a dirty page,
    * you should write it back to the disk first. You also need to reset the memory and metadata for the new page.
    *
-   * Remember to "Pin" the frame by calling replacer.SetEvictable(frame_id, false)
-   * so that the replacer wouldn't evict the frame before the buffer pool manager "Unpin"s it.
-   * Also, remember to record the access history of the frame in the replacer for the lru-k algorithm to work.
+   * The frame is "Pinned" through its atomic pin count, which the replacer consults when it looks for a victim.
+   * Also, remember to record the access history of the frame in the replacer for the replacement policy to work.
    *
    * @param[out] page_id id of created page
+   * @param file_id the file to allocate the page in
    * @return nullptr if no new pages could be created, otherwise pointer to new page
    */
-  auto NewPage(page_id_t *page_id) -> Page *;
+  auto NewPage(page_id_t *page_id, file_id_t file_id = 0) -> Page *;
 
   /**
    * TODO(P1): Add implementation
@@ -64,28 +202,31 @@ class BufferPoolManager {
    * BasicPageGuard structure.
    *
    * @param[out] page_id, the id of the new page
+   * @param file_id the file to allocate the page in
    * @return BasicPageGuard holding a new page
    */
-  auto NewPageGuarded(page_id_t *page_id) -> BasicPageGuard;
+  auto NewPageGuarded(page_id_t *page_id, file_id_t file_id = 0) -> BasicPageGuard;
 
   /**
    * TODO(P1): Add implementation
    *
    * @brief Fetch the requested page from the buffer pool. Return nullptr if page_id needs to be fetched from the disk
-   * but all frames are currently in use and not evictable (in another word, pinned).
+   * but all frames are currently in use and not evictable (in another word, pinned) until the frame wait timeout, or
+   * if reading it from the disk failed; the page is then not kept in the pool.
    *
    * First search for page_id in the buffer pool. If not found, pick a replacement frame from either the free list or
-   * the replacer (always find from the free list first), read the page from disk by calling disk_manager_->ReadPage(),
+   * the replacer (always find from the free list first), read the page from disk by calling ReadPage() of its file,
    * and replace the old page in the frame. Similar to NewPage(), if the old page is dirty, you need to write it back
    * to disk and update the metadata of the new page
    *
    * In addition, remember to disable eviction and record the access history of the frame like you did for NewPage().
    *
    * @param page_id id of page to be fetched
-   * @param access_type type of access to the page, only needed for leaderboard tests.
+   * @param access_type type of access to the page, scan accesses are evicted first by the replacer
+   * @param file_id the file of the page
    * @return nullptr if page_id cannot be fetched, otherwise pointer to the requested page
    */
-  auto FetchPage(page_id_t page_id) -> Page *;
+  auto FetchPage(page_id_t page_id, AccessType access_type = AccessType::Unknown, file_id_t file_id = 0) -> Page *;
 
   /**
    * TODO(P1): Add implementation
@@ -98,11 +239,119 @@ class BufferPoolManager {
    * the returned page already has a read or write latch held, respectively.
    *
    * @param page_id, the id of the page to fetch
+   * @param access_type type of access to the page
+   * @param file_id the file of the page
    * @return PageGuard holding the fetched page
    */
-  auto FetchPageBasic(page_id_t page_id) -> BasicPageGuard;
-  auto FetchPageRead(page_id_t page_id) -> ReadPageGuard;
-  auto FetchPageWrite(page_id_t page_id) -> WritePageGuard;
+  auto FetchPageBasic(page_id_t page_id, AccessType access_type = AccessType::Unknown, file_id_t file_id = 0)
+      -> BasicPageGuard;
+  auto FetchPageRead(page_id_t page_id, AccessType access_type = AccessType::Unknown, file_id_t file_id = 0)
+      -> ReadPageGuard;
+  auto FetchPageWrite(page_id_t page_id, AccessType access_type = AccessType::Unknown, file_id_t file_id = 0)
+      -> WritePageGuard;
+
+  /**
+   * @brief Fetch the page only if it is resident and readable right away, never doing i/o or waiting for it.
+   *
+   * @param page_id, the id of the page to fetch
+   * @param access_type type of access to the page
+   * @param file_id the file of the page
+   * @return ReadPageGuard holding the page, or an invalid guard if the page is not in the buffer pool or still
+   * being read by a prefetch
+   */
+  auto TryFetchPageRead(page_id_t page_id, AccessType access_type = AccessType::Unknown, file_id_t file_id = 0)
+      -> ReadPageGuard;
+
+  /**
+   * @brief Asynchronously read a page into the buffer pool without pinning it.
+   *
+   * The request is queued for a background prefetch thread, started on first use. When it is served the page is
+   * read into a frame picked like FetchPage() does and left unpinned and evictable. A FetchPage() of the page while
+   * the read is in flight waits for it instead of reading the page again. Requests are handed over through a lock-free
+   * queue. Requests for resident pages, and requests beyond a queue of max(1, pool_size / 4) or PREFETCH_QUEUE_SIZE,
+   * are dropped.
+   *
+   * @param page_id id of page to be prefetched
+   * @param access_type recorded for the page once it is read, by default it stays on probation until really used
+   * @param file_id the file of the page
+   */
+  void Prefetch(page_id_t page_id, AccessType access_type = AccessType::Scan, file_id_t file_id = 0);
+
+  /**
+   * @brief Pin a page for good, for hot pages like the upper levels of a tree.
+   *
+   * The frame is never evicted until ReleaseResident() is called, so the caller may keep the returned pointer and
+   * access the page through a resident guard, skipping the page table, the replacer and the pin count.
+   *
+   * @param page_id id of page to be pinned
+   * @param file_id the file of the page
+   * @return nullptr if page_id cannot be fetched, otherwise pointer to the resident page
+   */
+  auto PinResident(page_id_t page_id, file_id_t file_id = 0) -> Page * {
+    return FetchPage(page_id, AccessType::Index, file_id);
+  }
+
+  /** @brief Give up the pin taken by PinResident(). */
+  void ReleaseResident(Page *page);
+
+  /** @brief Mark a pinned page dirty, used by resident guards which never unpin. */
+  void MarkDirty(Page *page);
+
+  /**
+   * @brief Turn pointer swizzling on or off, it is off by default.
+   *
+   * With swizzling on, FetchChild() replaces the reference to a page it fetched with a tagged frame id, so that the
+   * next fetch through the same reference goes straight to the frame without looking up the page table. Tagged
+   * references only ever live in memory: they are restored to page ids in the copy written to disk, when the child
+   * is evicted or deleted, and when the parent is evicted. Turning swizzling off restores every tagged reference.
+   */
+  void EnableSwizzling(bool enable);
+
+  /** @return true if ref is a tagged frame reference, i.e. it was swizzled by FetchChild() */
+  static constexpr auto IsSwizzled(page_id_t ref) -> bool { return ref < INVALID_PAGE_ID; }
+
+  /**
+   * @return the value of a child reference inside a frame. Readers of the parent may swizzle or restore it under
+   * latch_ at any time, so it is always read and written atomically.
+   */
+  static auto LoadRef(const page_id_t *ref) -> page_id_t {
+    return std::atomic_ref<page_id_t>(*const_cast<page_id_t *>(ref)).load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Fetch the page a reference stored in another page points to, swizzling the reference if enabled.
+   *
+   * The reference is read through LoadRef(), as it may be swizzled or restored concurrently. The page holding it must
+   * be pinned by the caller and must not be restructured while it holds tagged references, see Unswizzle(). The
+   * child is looked up in the file of that page.
+   *
+   * @param ref address of a page id, or of a tagged reference, inside a frame of this buffer pool
+   * @param access_type type of access to the page
+   * @return nullptr if the page cannot be fetched, otherwise pointer to the requested page
+   */
+  auto FetchChild(const page_id_t *ref, AccessType access_type = AccessType::Unknown) -> Page *;
+
+  /** @brief PageGuard wrappers for FetchChild */
+  auto FetchChildRead(const page_id_t *ref, AccessType access_type = AccessType::Unknown) -> ReadPageGuard;
+  auto FetchChildWrite(const page_id_t *ref, AccessType access_type = AccessType::Unknown) -> WritePageGuard;
+
+  /**
+   * @brief Restore every tagged reference held by a pinned page to a plain page id.
+   *
+   * Must be called before references in the page are moved, copied to another page or read as page ids.
+   *
+   * @param page_data the data of a pinned page of this buffer pool
+   */
+  void Unswizzle(const void *page_data);
+
+  /** @return number of fetches served through a swizzled reference */
+  auto GetSwizzledHitCount() const -> size_t { return swizzled_hits_.Load(); }
+
+  /** @return true if the page is in the page table, including while a prefetch is reading it */
+  auto IsResident(page_id_t page_id, file_id_t file_id = 0) -> bool {
+    std::scoped_lock lock(latch_);
+    return page_table_.find(PageKey(file_id, page_id)) != page_table_.end();
+  }
 
   /**
    * TODO(P1): Add implementation
@@ -110,15 +359,24 @@ class BufferPoolManager {
    * @brief Unpin the target page from the buffer pool. If page_id is not in the buffer pool or its pin count is already
    * 0, return false.
    *
-   * Decrement the pin count of a page. If the pin count reaches 0, the frame should be evictable by the replacer.
+   * Decrement the pin count of a page. Once the pin count reaches 0 the replacer may pick the frame.
    * Also, set the dirty flag on the page to indicate if the page was modified.
    *
    * @param page_id id of page to be unpinned
    * @param is_dirty true if the page should be marked as dirty, false otherwise
-   * @param access_type type of access to the page, only needed for leaderboard tests.
+   * @param file_id the file of the page
    * @return false if the page is not in the page table or its pin count is <= 0 before this call, true otherwise
    */
-  auto UnpinPage(page_id_t page_id, bool is_dirty) -> bool;
+  auto UnpinPage(page_id_t page_id, bool is_dirty, file_id_t file_id = 0) -> bool;
+
+  /**
+   * @brief Unpin a page known to be pinned by the caller, without the page table lookup of UnpinPage() and without
+   * taking latch_. This is what page guards use.
+   *
+   * @param page the pinned page
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   */
+  void UnpinFrame(Page *page, bool is_dirty);
 
   /**
    * TODO(P1): Add implementation
@@ -129,49 +387,447 @@ class BufferPoolManager {
    * Unset the dirty flag of the page after flushing.
    *
    * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
-   * @return false if the page could not be found in the page table, true otherwise
+   * @param file_id the file of the page
+   * @return false if the page could not be found in the page table or could not be written, true otherwise
    */
-  auto FlushPage(page_id_t page_id) -> bool;
+  auto FlushPage(page_id_t page_id, file_id_t file_id = 0) -> bool;
 
   /**
    * TODO(P1): Add implementation
    *
-   * @brief Flush all the pages in the buffer pool to disk.
+   * @brief Flush all the pages in the buffer pool to disk, of every file. Pages that could not be written stay dirty.
    */
   void FlushAllPages();
 
   /**
    * TODO(P1): Add implementation
    *
-   * @brief Delete a page from the buffer pool. If page_id is not in the buffer pool, do nothing and return true. If the
-   * page is pinned and cannot be deleted, return false immediately.
+   * @brief Delete a page from the buffer pool. If page_id is not in the buffer pool, only deallocate it and return
+   * true. If the page is pinned and cannot be deleted, return false immediately.
    *
    * After deleting the page from the page table, stop tracking the frame in the replacer and add the frame
    * back to the free list. Also, reset the page's memory and metadata. Finally, you should call DeallocatePage() to
    * imitate freeing the page on the disk.
    *
    * @param page_id id of page to be deleted
+   * @param file_id the file of the page
    * @return false if the page exists but could not be deleted, true if the page didn't exist or deletion succeeded
    */
-  auto DeletePage(page_id_t page_id) -> bool;
+  auto DeletePage(page_id_t page_id, file_id_t file_id = 0) -> bool;
+
+  /**
+   * @brief Enter an epoch, to be held by a tree operation for its whole duration, around all of its page guards.
+   *
+   * Pages unlinked by the operation are passed to EpochGuard::Retire() instead of DeletePage(). They are deleted once
+   * no operation that might still reach them is running and they are no longer pinned, see EpochManager.
+   */
+  auto EnterEpoch() -> EpochGuard { return epoch_manager_.Enter(); }
+
+  /** @return number of retired pages waiting to be deleted and of retired resident pins waiting to be given up */
+  auto GetRetiredPageCount() const -> size_t { return epoch_manager_.GetRetiredCount(); }
+
+  /** @return true if the file was created when it was opened */
+  auto IsNew(file_id_t file_id = 0) -> bool { return files_[file_id]->IsNew(); }
+
+  /**
+   * @brief Start the background flusher.
+   *
+   * The flusher sweeps the frames like a clock hand and writes dirty, unpinned frames back to disk whenever more
+   * than dirty_ratio of the pool is dirty, so that eviction in the foreground almost always finds a clean victim.
+   * It wakes up every interval, or earlier when UnpinPage() pushes the dirty count over the target.
+   *
+   * @param dirty_ratio target ratio of dirty frames in the pool
+   * @param batch_size max number of pages written before the flusher checks the target again
+   * @param interval how long the flusher sleeps when there is nothing to do
+   */
+  void StartFlusher(double dirty_ratio = FLUSHER_DIRTY_RATIO, size_t batch_size = FLUSHER_BATCH_SIZE,
+                    std::chrono::milliseconds interval = std::chrono::milliseconds(FLUSHER_INTERVAL_MS));
+
+  /** @brief Stop the background flusher and wait for it to exit. Does nothing if it is not running. */
+  void StopFlusher();
+
+  /** @return number of pages written back by the background flusher */
+  auto GetFlushedPageCount() const -> size_t { return flushed_pages_.Load(); }
+
+  /** @return number of dirty victims written back synchronously in the foreground by FetchPage() or NewPage() */
+  auto GetSyncWriteBackCount() const -> size_t { return sync_write_backs_.Load(); }
+
+  /**
+   * @brief Start the background evictor.
+   *
+   * The evictor keeps a reservoir of clean free frames: once the free list drops below low_watermark frames it evicts
+   * victims from the replacer, writing dirty ones back without holding latch_, until high_watermark frames are free.
+   * A miss in the foreground then only pops a frame and reads, and falls back to evicting inline only when the
+   * reservoir runs dry.
+   *
+   * @param low_watermark ratio of frames below which the evictor starts refilling the free list
+   * @param high_watermark ratio of frames at which the evictor stops
+   */
+  void StartEvictor(double low_watermark = EVICTOR_LOW_WATERMARK, double high_watermark = EVICTOR_HIGH_WATERMARK);
+
+  /** @brief Stop the background evictor and wait for it to exit. Does nothing if it is not running. */
+  void StopEvictor();
+
+  /** @return number of frames evicted by the background evictor */
+  auto GetBackgroundEvictionCount() const -> size_t { return background_evictions_.Load(); }
+
+  /** @return number of frames evicted inline because the free list was empty */
+  auto GetForegroundEvictionCount() const -> size_t { return foreground_evictions_.Load(); }
+
+  /** @return number of pages read into the pool by Prefetch() */
+  auto GetPrefetchedPageCount() const -> size_t { return prefetched_pages_.Load(); }
+
+  /** @return number of frames in the free list */
+  auto GetFreeFrameCount() -> size_t {
+    std::scoped_lock lock(latch_);
+    return free_list_.size();
+  }
+
+  /** @return number of dirty frames in the pool */
+  auto GetDirtyPageCount() -> size_t { return dirty_count_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Start logging every page access to a binary trace file, for the replacer simulator in tools/.
+   *
+   * Fetches, including hits of TryFetchPageRead(), and new pages are logged as hits or misses, pages read by the
+   * prefetcher as prefetches and deleted pages as deletions. Pages read through resident guards are not logged; they
+   * stay in the pool whatever the policy.
+   *
+   * @param path the trace file, truncated if it exists
+   * @return false if the file cannot be opened
+   */
+  auto StartTrace(const std::string &path) -> bool { return tracer_.Start(path); }
 
-  auto IsNew() -> bool { return disk_manager_->IsNew(); }
+  /** @brief Stop logging page accesses and close the trace file. Does nothing if no trace is running. */
+  void StopTrace() { tracer_.Stop(); }
+
+  /** @return number of page accesses logged by the current or last trace */
+  auto GetTracedAccessCount() const -> size_t { return tracer_.GetRecordCount(); }
+
+  /** @brief Take a snapshot of the counters of the buffer pool, its replacer and the disk managers of its files. */
+  auto GetStats() -> BufferPoolStats;
+
+  /**
+   * @return number of pages the calling thread fetched from any buffer pool so far. The difference across an
+   * operation is the number of pages the operation fetched.
+   */
+  static auto GetThreadFetchCount() -> size_t { return thread_fetches_; }
 
  private:
-  /** Number of pages in the buffer pool. */
-  const size_t pool_size_;
+  /** @return the page table key of a page */
+  static constexpr auto PageKey(file_id_t file_id, page_id_t page_id) -> page_key_t {
+    return static_cast<uint64_t>(static_cast<uint32_t>(file_id)) << 32 | static_cast<uint32_t>(page_id);
+  }
+
+  /**
+   * @brief Pick a frame for a new page, from the free list first and then from the replacer. A dirty victim is
+   * written back and removed from the page table. A file at its quota replaces one of its own pages instead. Must be
+   * called with latch_ held.
+   *
+   * @param[out] frame_id the frame picked
+   * @param file_id the file of the new page
+   * @return false if every frame is pinned
+   */
+  auto AcquireFrame(frame_id_t *frame_id, file_id_t file_id) -> bool;
 
-  /** Array of buffer pool pages. */
+  /**
+   * @brief AcquireFrame(), waiting on frame_cv_ up to frame_wait_timeout_ while every frame is pinned. latch_ is
+   * released while waiting, so the caller has to check again whether the page it wants got into the pool meanwhile.
+   *
+   * @param[out] waited set to true if the call waited
+   * @return false on timeout
+   */
+  auto WaitForFrame(frame_id_t *frame_id, file_id_t file_id, std::unique_lock<std::mutex> &lock, bool *waited)
+      -> bool;
+
+  /**
+   * Wake the threads waiting for a frame, after a frame was unpinned or freed. Must be called with latch_ held,
+   * NotifyUnpinned() is for callers not holding it.
+   */
+  void WakeFrameWaiters() {
+    if (frame_waiters_.load(std::memory_order_seq_cst) > 0) {
+      frame_cv_.notify_all();
+    }
+  }
+  void NotifyUnpinned() {
+    if (frame_waiters_.load(std::memory_order_seq_cst) > 0) {
+      std::scoped_lock lock(latch_);
+      frame_cv_.notify_all();
+    }
+  }
+
+  /** Enter a page in the page table and in the frame count of its file. Must be called with latch_ held. */
+  void InstallPage(frame_id_t frame_id, page_id_t page_id, file_id_t file_id);
+
+  /** Remove the page of a claimed frame from the page table and empty the frame. Must be called with latch_ held. */
+  void DropPage(frame_id_t frame_id);
+
+  /**
+   * @brief Write pages back in (file, page id) order, so that runs of consecutive pages go out as one pwritev.
+   *
+   * Does not touch any frame, the caller pins the frames or holds latch_ as long as the data pointers are in use.
+   *
+   * @param pages PageKey() and data of each page to write, sorted in place
+   * @return false if any page could not be written, the caller then marks its frames dirty again
+   */
+  auto WriteSorted(vector<pair<uint64_t, const char *>> *pages) -> bool;
+
+  /**
+   * @brief The body of FetchPage(), called with latch_ held through lock. Waits for a prefetch in flight.
+   */
+  auto FetchPageLocked(page_id_t page_id, file_id_t file_id, AccessType access_type,
+                       std::unique_lock<std::mutex> &lock) -> Page *;
+
+  /**
+   * Pin a resident frame for a fetch. Must be called with latch_ held through lock.
+   * @return false if the frame was being read by the prefetcher and the read failed, the pin is then given back and
+   * the page is no longer in the pool
+   */
+  auto PinFrame(frame_id_t frame_id, AccessType access_type, std::unique_lock<std::mutex> &lock) -> bool;
+
+  /**
+   * Drop the page of a frame whose read failed and give up a pin on it. The last pin to go returns the frame to the
+   * free list, the others are fetches that waited for the read. Must be called with latch_ held.
+   */
+  void DropFailedRead(frame_id_t frame_id);
+
+  /**
+   * Pin a frame without latch_, with a single compare-and-swap unless it races with another pin.
+   * @return false if the frame is claimed (pin count -1), the caller then has to go through the page table
+   */
+  static auto TryPin(Page &frame) -> bool {
+    int pins = frame.pin_count_.load(std::memory_order_relaxed);
+    while (pins >= 0) {
+      if (frame.pin_count_.compare_exchange_weak(pins, pins + 1, std::memory_order_acquire,
+                                                 std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Claim an unpinned frame for eviction or deletion by moving its pin count from 0 to -1, so that TryPin() fails
+   * on it from now on. Must be called with latch_ held.
+   * @return false if the frame is pinned
+   */
+  static auto Claim(Page &frame) -> bool {
+    int unpinned = 0;
+    return frame.pin_count_.compare_exchange_strong(unpinned, -1, std::memory_order_acq_rel);
+  }
+
+  /**
+   * Record a hit on a resident frame through the access buffer, draining it if the stripe is full. Must be called
+   * with latch_ held. A miss is recorded in the replacer directly, since the frame has to be tracked right away.
+   */
+  void RecordHit(frame_id_t frame_id, AccessType access_type);
+
+  /** Hand the hits waiting in the access buffer to the replacer. Must be called with latch_ held. */
+  void DrainAccesses();
+
+  /**
+   * Evict the replacer's victim among the unpinned frames and claim it. Frames are handed to the replacer once, when
+   * they are read, and their evictability is only looked up here. Must be called with latch_ held.
+   * @param file_id only evict pages of this file, unless INVALID_FILE_ID
+   * @return false if every frame is pinned
+   */
+  auto EvictFrame(frame_id_t *frame_id, file_id_t file_id = INVALID_FILE_ID) -> bool;
+
+  /** @return the frame whose data contains address */
+  auto FrameOf(const void *address) const -> frame_id_t {
+    return static_cast<frame_id_t>((static_cast<const char *>(address) - frame_arena_) / BUSTUB_PAGE_SIZE);
+  }
+
+  /**
+   * Swizzling bookkeeping, all must be called with latch_ held. UnswizzleChild() restores the reference to a
+   * swizzled child, UnswizzleFrame() restores every link of a frame that is about to be freed.
+   */
+  void UnswizzleChild(frame_id_t frame_id);
+  void UnswizzleFrame(frame_id_t frame_id);
+
+  /** Store a child reference, see LoadRef(). */
+  static void StoreRef(const page_id_t *ref, page_id_t value) {
+    std::atomic_ref<page_id_t>(*const_cast<page_id_t *>(ref)).store(value, std::memory_order_release);
+  }
+
+  /** Copy the data of a frame into buffer, restoring the tagged references in the copy. */
+  void CopyUnswizzled(const Page &frame, char *buffer) const;
+
+  /** Write a frame to disk synchronously, holding latch_. @return false if the write failed */
+  auto WriteFrame(Page &frame) -> bool;
+
+  /** Keep dirty_count_ in sync with the dirty flags. SetClean() must be called with latch_ held. */
+  void SetDirty(Page &frame);
+  void SetClean(Page &frame);
+
+  /** Body of the background flusher thread. */
+  void FlusherLoop();
+
+  /** Start the prefetch thread if it is not running. Must be called with latch_ held. */
+  void StartPrefetcher();
+
+  /** Body of the prefetch thread. */
+  void PrefetchLoop();
+
+  /** Body of the warm-up thread, which feeds the pages in warm_up_ to the prefetcher while frames are free. */
+  void WarmUpLoop();
+
+  /** Wake the evictor up to refill the free list. Must be called with latch_ held. */
+  void KickEvictor();
+
+  /** Body of the background evictor thread. */
+  void EvictorLoop();
+
+  /** @return bytes of the frame arena covering the first frames frames, rounded up to whole huge pages */
+  static constexpr auto ArenaBytes(size_t frames) -> size_t {
+    return (frames * BUSTUB_PAGE_SIZE + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+  }
+
+  /** Reserve address space for the frame arena, aligned to a huge page and advised for transparent huge pages. */
+  void MapArena();
+
+  /**
+   * Make arena bytes [begin, end), whole huge pages, accessible. They are backed by explicit huge pages while the
+   * system has enough of them set aside, by transparent ones from the first time it has not.
+   */
+  auto CommitArena(size_t begin, size_t end) -> bool;
+
+  /** Give the memory of arena bytes [begin, end), whole huge pages, back to the system and reserve them again. */
+  void DecommitArena(size_t begin, size_t end);
+
+  /** Add frames [pool_size_, pool_size) to the pool. Must be called with latch_ held. */
+  auto GrowFrames(size_t pool_size) -> bool;
+
+  /**
+   * Empty frames [low, pool_size_) and drop them from the pool, waiting for pinned ones until deadline. latch_ is
+   * released while waiting. On timeout the frames emptied so far go back to the free list.
+   */
+  auto ReleaseFrames(size_t low, std::unique_lock<std::mutex> &lock, std::chrono::steady_clock::time_point deadline)
+      -> bool;
+
+  /** Recompute the flusher and evictor targets from their ratios and the pool size. Must be called with latch_ held. */
+  void UpdateBackgroundTargets();
+
+  /** Number of frames in the buffer pool, changed by Resize() with latch_ held. */
+  std::atomic<size_t> pool_size_;
+  /** Number of frames address space is reserved for. */
+  const size_t max_pool_size_;
+  /** Number of frames whose Page has been constructed, they are kept when the pool shrinks. */
+  size_t constructed_frames_{0};
+  /** Serializes Resize() calls. */
+  std::mutex resize_latch_;
+
+  /** Array of buffer pool pages, in address space reserved for max_pool_size_ frames. */
   Page *pages_;
-  /** Pointer to the disk manager. */
-  MyDiskManager *disk_manager_;
-  /** Page table for keeping track of buffer pool pages. */
-  linked_hashmap<page_id_t, frame_id_t> page_table_;
+  /**
+   * Page data of all frames, kept apart from the metadata in pages_ so that scans over the metadata stay dense.
+   * Address space is reserved for max_pool_size_ frames, rounded up to arena_size_ bytes of whole huge pages, of
+   * which the huge pages covering the first pool_size_ frames are accessible, see CommitArena().
+   */
+  char *frame_arena_;
+  size_t arena_size_;
+  /** True as long as every committed huge page of the arena is an explicit one. */
+  bool hugetlb_arena_{true};
+  /** True if files are opened with O_DIRECT. */
+  const bool direct_io_;
+  /**
+   * Disk managers and names of the files served by the pool, indexed by file id. Files are only ever added, under
+   * latch_, so a disk manager can be used without it once its page is in a frame.
+   */
+  MyDiskManager *files_[MAX_FILES]{};
+  std::string file_names_[MAX_FILES];
+  size_t file_count_{0};
+  /** Frames holding pages of each file, and the quota of each file, 0 for none. Protected by latch_. */
+  size_t file_frames_[MAX_FILES]{};
+  size_t file_quotas_[MAX_FILES]{};
+  /** Page table for keeping track of buffer pool pages, keyed by PageKey(). */
+  flat_hashmap<uint64_t, frame_id_t> page_table_;
   /** Replacer to find unpinned pages for replacement. */
-  LRUKReplacer *replacer_;
+  Replacer *replacer_;
+  /** Page hits waiting to be recorded in the replacer, drained with latch_ held. */
+  AccessBuffer access_buffer_;
+  /** Deferred deletion of retired pages through DeletePage(). */
+  EpochManager epoch_manager_;
+  /** Page access log, see StartTrace(). */
+  AccessTracer tracer_;
   /** List of free frames that don't have any pages on them. */
   list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
-  //  std::mutex latch_;
+  /** This latch protects the page table, the free list, the replacer and the metadata of every frame. */
+  std::mutex latch_;
+  /** Number of dirty frames. */
+  std::atomic<size_t> dirty_count_{0};
+  /**
+   * Threads waiting in WaitForFrame(). Unpinning a frame notifies frame_cv_ only while there are any, taking latch_
+   * so that the notification cannot slip in between a waiter's last attempt and its wait.
+   */
+  std::atomic<size_t> frame_waiters_{0};
+  std::condition_variable frame_cv_;
+  std::chrono::milliseconds frame_wait_timeout_{FRAME_WAIT_TIMEOUT_MS};
+  /** True if FetchChild() swizzles references. */
+  bool swizzling_{false};
+  /** Aligned scratch page for synchronous writes of frames holding tagged references. */
+  char *io_buffer_;
+
+  /** Background flusher state, all protected by latch_. */
+  std::thread flusher_;
+  std::condition_variable flusher_cv_;
+  std::atomic<bool> flusher_running_{false};
+  bool flusher_stop_{false};
+  /** Also set by UnpinFrame() without latch_, the flusher then wakes up at the latest after its interval. */
+  std::atomic<bool> flusher_kicked_{false};
+  double flusher_dirty_ratio_{FLUSHER_DIRTY_RATIO};
+  /** Read by UnpinFrame() without latch_. */
+  std::atomic<size_t> flusher_dirty_target_{0};
+  size_t flusher_batch_size_{FLUSHER_BATCH_SIZE};
+  std::chrono::milliseconds flusher_interval_{FLUSHER_INTERVAL_MS};
+  /** Next frame the flusher looks at. */
+  size_t flush_hand_{0};
+
+  /** Background evictor state, all protected by latch_. */
+  std::thread evictor_;
+  std::condition_variable evictor_cv_;
+  bool evictor_running_{false};
+  bool evictor_stop_{false};
+  bool evictor_kicked_{false};
+  double evictor_low_ratio_{EVICTOR_LOW_WATERMARK};
+  double evictor_high_ratio_{EVICTOR_HIGH_WATERMARK};
+  size_t evictor_low_watermark_{0};
+  size_t evictor_high_watermark_{0};
+
+  /**
+   * Prefetch state, protected by latch_ except for the request queue the prefetcher sleeps on. io_cv_ is notified
+   * whenever a prefetch read completes.
+   */
+  std::thread prefetcher_;
+  std::condition_variable io_cv_;
+  struct PrefetchRequest {
+    page_id_t page_id_;
+    file_id_t file_id_;
+    AccessType access_type_;
+  };
+  ConcurrentQueue<PrefetchRequest, PREFETCH_QUEUE_SIZE> prefetch_queue_;
+  bool prefetcher_running_{false};
+  bool prefetcher_stop_{false};
+  /** Saved hot pages still to be prefetched on startup, see OpenFile(). Protected by latch_. */
+  std::thread warmer_;
+  list<PrefetchRequest> warm_up_;
+  bool warmer_running_{false};
+
+  /** Page fetches of the calling thread in any buffer pool, see GetThreadFetchCount(). */
+  static inline thread_local size_t thread_fetches_{0};
+
+  StripedCounter hits_;
+  StripedCounter misses_;
+  StripedCounter new_pages_;
+  StripedCounter deleted_pages_;
+  StripedCounter fetch_failures_;
+  StripedCounter frame_waits_;
+  StripedCounter frame_wait_us_;
+  StripedCounter flushed_pages_;
+  StripedCounter sync_write_backs_;
+  StripedCounter background_evictions_;
+  StripedCounter foreground_evictions_;
+  StripedCounter prefetched_pages_;
+  StripedCounter swizzled_hits_;
 };
 }  // namespace CrazyDave
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+#include "data_structures/vector.h"
+
+namespace CrazyDave {
+
+/**
+ * ClockReplacer implements the CLOCK (second chance) policy.
+ *
+ * Tracked frames carry a reference bit, set by every access after the one that brought the page in. The clock hand
+ * sweeps the frames: a referenced frame loses its bit and is passed over, the first evictable frame without it is the
+ * victim. Each bit is cleared at most once per access, so eviction is O(1) amortized.
+ *
+ * A freshly read page starts unreferenced, and scan accesses never set the bit, so pages touched once by a scan go
+ * before the working set.
+ */
+class ClockReplacer : public Replacer {
+ public:
+  /** @param num_frames the maximum number of frames the replacer will be required to store */
+  explicit ClockReplacer(size_t num_frames);
+
+  ~ClockReplacer() override = default;
+
+  auto Evict(frame_id_t *frame_id, const std::function<auto(frame_id_t)->bool> &evictable = {}) -> bool override;
+
+  void RecordAccess(frame_id_t frame_id, AccessType access_type = AccessType::Unknown,
+                    page_key_t page_key = INVALID_PAGE_KEY) override;
+
+  void SetEvictable(frame_id_t frame_id, bool set_evictable) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  auto Size() -> size_t override { return curr_size_; }
+
+  void SetCapacity(size_t num_frames) override;
+
+  void GetHotFrames(vector<frame_id_t> *frames) override;
+
+ private:
+  struct Entry {
+    bool tracked_{false};
+    bool referenced_{false};
+    bool is_evictable_{false};
+  };
+
+  vector<Entry> entries_;
+  /** Next frame the hand looks at. */
+  size_t hand_{0};
+  size_t tracked_count_{0};
+  size_t curr_size_{0};
+};
+
+}  // namespace CrazyDave
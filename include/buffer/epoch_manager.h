@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+#include "common/config.h"
+#include "common/utils.h"
+#include "data_structures/vector.h"
+
+namespace CrazyDave {
+
+class EpochManager;
+class Page;
+
+/**
+ * RAII handle of a thread inside an epoch, see EpochManager::Enter(). Pages unlinked while holding it are handed to
+ * Retire(). The guard must outlive every page guard taken under it.
+ */
+class EpochGuard {
+  friend EpochManager;
+
+ public:
+  EpochGuard() = default;
+  EpochGuard(const EpochGuard &) = delete;
+  auto operator=(const EpochGuard &) -> EpochGuard & = delete;
+  EpochGuard(EpochGuard &&that) noexcept;
+  auto operator=(EpochGuard &&that) noexcept -> EpochGuard &;
+  ~EpochGuard();
+
+  /**
+   * @brief Defer the deletion of a page unlinked from the structure until no thread can still reach it.
+   * @param page_id id of the page, it must not be retired twice
+   * @param file_id file of the page
+   */
+  void Retire(page_id_t page_id, file_id_t file_id = 0);
+
+  /**
+   * @brief Defer giving up a resident pin until no thread can still use the frame pointer it was published under.
+   * @param page frame pinned by BufferPoolManager::PinResident(), no longer reachable by threads entering later
+   */
+  void RetirePin(Page *page);
+
+  /** Leave the epoch early, reclaiming retired pages if enough of them piled up. */
+  void Drop();
+
+ private:
+  EpochGuard(EpochManager *manager, int slot) : manager_(manager), slot_(slot) {}
+
+  EpochManager *manager_{nullptr};
+  int slot_{-1};
+};
+
+/**
+ * EpochManager implements epoch based reclamation of deleted pages.
+ *
+ * Every operation runs inside an epoch: Enter() announces the current global epoch in a slot of the calling thread
+ * and the returned guard clears it again. A page unlinked by an operation is retired, stamped with the global epoch,
+ * into the list of that slot instead of being deleted right away, since a concurrent reader may have read a
+ * reference to it before it was unlinked and not pinned it yet. Once the slot holds EPOCH_RECLAIM_BATCH retired
+ * pages, leaving the epoch tries to advance the global epoch (possible when every active slot has seen it) and
+ * reclaims the pages stamped before the oldest epoch still announced. Reclaiming a page that is still pinned fails
+ * and the page is kept for the next round, so a retired page is never leaked. Resident pins retired by RetirePin()
+ * go the same way, and are given up instead.
+ *
+ * Slots are claimed per operation, starting at a slot picked by the thread id, so a thread keeps using the same slot
+ * and its retired list. A slot released with retired pages left is inherited by its next owner.
+ */
+class EpochManager {
+  friend EpochGuard;
+
+ public:
+  /**
+   * @param reclaim deletes a page of a file, returning false if it cannot be deleted yet
+   * @param unpin gives up a resident pin on a frame
+   */
+  EpochManager(std::function<auto(page_id_t, file_id_t)->bool> reclaim, std::function<void(Page *)> unpin);
+
+  /** Retired pages left are dropped, the owner calls ReclaimAll() first while reclaim can still run. */
+  ~EpochManager() = default;
+
+  EpochManager(const EpochManager &) = delete;
+  auto operator=(const EpochManager &) -> EpochManager & = delete;
+
+  /** @return a guard holding the calling thread inside the current epoch */
+  auto Enter() -> EpochGuard;
+
+  /**
+   * Reclaim every retired page that can be and give up every retired pin, whatever their epoch. Only call it while no
+   * thread is inside an epoch.
+   */
+  void ReclaimAll();
+
+  /** @return the global epoch */
+  auto GetEpoch() const -> uint64_t { return global_epoch_.load(std::memory_order_relaxed); }
+
+  /** @return number of retired pages and pins not reclaimed yet, exact only while no thread is inside an epoch */
+  auto GetRetiredCount() const -> size_t;
+
+ private:
+  static constexpr uint64_t INACTIVE = UINT64_MAX;
+
+  /** A retired page, or a retired pin if pin_ is set. */
+  struct Retired {
+    uint64_t epoch_;
+    page_id_t page_id_;
+    file_id_t file_id_;
+    Page *pin_;
+  };
+
+  struct alignas(CACHE_LINE_SIZE) Slot {
+    std::atomic<bool> owned_{false};
+    std::atomic<uint64_t> epoch_{INACTIVE};
+    /** Retired pages and pins and the epoch they were retired in, only touched by the owner of the slot. */
+    vector<Retired> retired_;
+  };
+
+  void Exit(int slot);
+
+  /** Advance the global epoch if every thread inside an epoch has announced the current one. */
+  void TryAdvance();
+
+  /** Reclaim the pages of a slot retired before any epoch still announced. */
+  void Reclaim(Slot &slot);
+
+  /** @return true if the entry is done with: the pin given up or the page deleted */
+  auto Reclaim(const Retired &entry) -> bool;
+
+  std::function<auto(page_id_t, file_id_t)->bool> reclaim_;
+  std::function<void(Page *)> unpin_;
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> global_epoch_{0};
+  Slot slots_[EPOCH_SLOTS];
+};
+
+}  // namespace CrazyDave
@@ -1,5 +1,9 @@
+#pragma once
+
+#include <functional>
+#include "buffer/replacer.h"
 #include "common/config.h"
-#include "data_structures/linked_hashmap.h"
+#include "data_structures/flat_hashmap.h"
 #include "data_structures/list.h"
 namespace CrazyDave {
 
@@ -16,6 +20,8 @@ class LRUKNode {
   size_t k_{};
   frame_id_t fid_{};
   bool is_evictable_{false};
+  /** True while every access to this frame has been a scan. */
+  bool is_scan_{false};
 };
 
 /**
@@ -28,8 +34,10 @@ class LRUKNode {
  * A frame with less than k historical references is given
  * +inf as its backward k-distance. When multipe frames have +inf backward k-distance,
  * classical LRU algorithm is used to choose victim.
+ *
+ * Frames only ever accessed by scans sit in a probationary segment that is always evicted first, in LRU order.
  */
-class LRUKReplacer {
+class LRUKReplacer : public Replacer {
  public:
   /**
    *
@@ -45,13 +53,13 @@ class LRUKReplacer {
    *
    * @brief Destroys the LRUReplacer.
    */
-  ~LRUKReplacer() = default;
+  ~LRUKReplacer() override = default;
 
   /**
    * TODO(P1): Add implementation
    *
    * @brief find the frame with largest backward k-distance and evict that frame. Only frames
-   * that are marked as 'evictable' are candidates for eviction.
+   * that are marked as 'evictable' are candidates for eviction. Evictable scan-only frames go first.
    *
    * A frame with less than k historical references is given +inf as its backward k-distance.
    * If multiple frames have inf backward k-distance, then evict frame with earliest timestamp
@@ -60,10 +68,14 @@ class LRUKReplacer {
    * Successful eviction of a frame should decrement the size of replacer and remove the frame's
    * access history.
    *
+   * If an evictable filter is given, it decides which frames are candidates instead of the 'evictable' marks, so a
+   * caller tracking pins elsewhere does not have to call SetEvictable() on every pin and unpin.
+   *
    * @param[out] frame_id id of frame that is evicted.
+   * @param evictable optional filter deciding whether a frame may be evicted
    * @return true if a frame is evicted successfully, false if no frames can be evicted.
    */
-  auto Evict(frame_id_t *frame_id) -> bool;
+  auto Evict(frame_id_t *frame_id, const std::function<auto(frame_id_t)->bool> &evictable = {}) -> bool override;
 
   /**
    * TODO(P1): Add implementation
@@ -74,11 +86,15 @@ class LRUKReplacer {
    * If frame id is invalid (ie. larger than replacer_size_), throw an exception. You can
    * also use BUSTUB_ASSERT to abort the process if frame id is invalid.
    *
+   * A scan access to a frame that has seen other kinds of access is not recorded, so scans neither promote
+   * nor age the working set. Any other access takes the frame off probation.
+   *
    * @param frame_id id of frame that received a new access.
-   * @param access_type type of access that was received. This parameter is only needed for
-   * leaderboard tests.
+   * @param access_type type of access that was received.
+   * @param page_key page held by the frame, unused by LRU-K
    */
-  void RecordAccess(frame_id_t frame_id);
+  void RecordAccess(frame_id_t frame_id, AccessType access_type = AccessType::Unknown,
+                    page_key_t page_key = INVALID_PAGE_KEY) override;
 
   /**
    * TODO(P1): Add implementation
@@ -97,7 +113,7 @@ class LRUKReplacer {
    * @param frame_id id of frame whose 'evictable' status will be modified
    * @param set_evictable whether the given frame is evictable or not
    */
-  void SetEvictable(frame_id_t frame_id, bool set_evictable);
+  void SetEvictable(frame_id_t frame_id, bool set_evictable) override;
 
   /**
    * TODO(P1): Add implementation
@@ -116,7 +132,7 @@ class LRUKReplacer {
    *
    * @param frame_id id of frame to be removed
    */
-  void Remove(frame_id_t frame_id);
+  void Remove(frame_id_t frame_id) override;
 
   /**
    * TODO(P1): Add implementation
@@ -125,10 +141,15 @@ class LRUKReplacer {
    *
    * @return size_t
    */
-  auto Size() -> size_t;
+  auto Size() -> size_t override;
+
+  /** @brief Change the number of frames, frames at or above num_frames must have been removed already. */
+  void SetCapacity(size_t num_frames) override;
+
+  void GetHotFrames(vector<frame_id_t> *frames) override;
 
  private:
-  linked_hashmap<frame_id_t, LRUKNode> node_store_;
+  flat_hashmap<frame_id_t, LRUKNode> node_store_;
   size_t current_timestamp_{0};
   size_t curr_size_{0};
   size_t replacer_size_;
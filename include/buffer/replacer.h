@@ -0,0 +1,99 @@
+#pragma once
+
+#include <functional>
+#include "common/config.h"
+#include "data_structures/vector.h"
+
+namespace CrazyDave {
+
+/**
+ * Hint passed along with every page access. Scan accesses put a frame on probation: it is evicted before any frame
+ * touched by another kind of access, so one full scan cannot push the working set of point lookups out of the pool.
+ * Lookup and Index accesses are ranked alike by every policy.
+ */
+enum class AccessType { Unknown = 0, Lookup, Scan, Index };
+
+/** Replacement policy of a buffer pool, picked when it is constructed. */
+enum class ReplacerType {
+  LRUK = 0,  // LRUKReplacer, evicts the frame with the largest backward k-distance
+  Clock,     // ClockReplacer, second chance with O(1) amortized eviction
+  ARC,       // ARCReplacer, adaptive replacement cache balancing recency and frequency
+};
+
+/** Counters of a replacer, updated by the replacer with the buffer pool latch held. */
+struct ReplacerStats {
+  size_t evictions_{0};         // victims picked by Evict()
+  size_t failed_evictions_{0};  // Evict() calls that found no victim
+  size_t frames_scanned_{0};    // frames looked at by Evict(), the cost of picking victims
+};
+
+/**
+ * Replacer is the interface of the replacement policies of the buffer pool manager. A replacer tracks the frames
+ * holding pages and picks the victim when the buffer pool needs a frame.
+ *
+ * Frames become tracked on their first RecordAccess(). Which tracked frames may be evicted is either given by
+ * SetEvictable() marks, or decided by the caller through the filter passed to Evict(). A replacer is not thread
+ * safe, the buffer pool manager calls it with its latch held.
+ */
+class Replacer {
+ public:
+  virtual ~Replacer() = default;
+
+  /**
+   * @brief Pick a victim among the evictable frames and stop tracking it.
+   *
+   * @param[out] frame_id id of frame that is evicted.
+   * @param evictable optional filter deciding whether a frame may be evicted, replacing the 'evictable' marks
+   * @return true if a frame is evicted successfully, false if no frames can be evicted.
+   */
+  virtual auto Evict(frame_id_t *frame_id, const std::function<auto(frame_id_t)->bool> &evictable = {}) -> bool = 0;
+
+  /**
+   * @brief Record an access to a frame, starting to track it if it is not tracked yet.
+   *
+   * @param frame_id id of frame that received a new access.
+   * @param access_type type of access that was received.
+   * @param page_key page held by the frame, qualified by its file, lets a policy remember pages it evicted
+   */
+  virtual void RecordAccess(frame_id_t frame_id, AccessType access_type = AccessType::Unknown,
+                            page_key_t page_key = INVALID_PAGE_KEY) = 0;
+
+  /** @brief Toggle whether a tracked frame is evictable or non-evictable. */
+  virtual void SetEvictable(frame_id_t frame_id, bool set_evictable) = 0;
+
+  /** @brief Stop tracking a frame, e.g. because its page was deleted. Does nothing if the frame is not tracked. */
+  virtual void Remove(frame_id_t frame_id) = 0;
+
+  /** @return number of frames marked evictable */
+  virtual auto Size() -> size_t = 0;
+
+  /**
+   * @brief Change the number of frames, when the buffer pool is resized. Frames at or above num_frames are no longer
+   * tracked when the pool shrinks.
+   */
+  virtual void SetCapacity(size_t num_frames) = 0;
+
+  /**
+   * @brief List the tracked frames from the hottest to the coldest, roughly the reverse of the order Evict() would
+   * pick them in. Used to remember the hot pages of a buffer pool across restarts.
+   *
+   * @param[out] frames filled with the tracked frames, hottest first
+   */
+  virtual void GetHotFrames(vector<frame_id_t> *frames) = 0;
+
+  /** @return the counters of the replacer, read with the same latch held as for the other calls */
+  auto GetStats() const -> const ReplacerStats & { return stats_; }
+
+ protected:
+  ReplacerStats stats_;
+};
+
+/**
+ * @brief Construct a replacer.
+ * @param type the replacement policy
+ * @param num_frames the maximum number of frames the replacer will be required to store
+ * @param k lookback window, only used by LRU-K
+ */
+auto MakeReplacer(ReplacerType type, size_t num_frames, size_t k) -> Replacer *;
+
+}  // namespace CrazyDave
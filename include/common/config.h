@@ -9,8 +9,40 @@ static constexpr int HEADER_PAGE_ID = 0;       // the header page id
 static constexpr int BUSTUB_PAGE_SIZE = 8192;  // size of a data page in byte
 static constexpr int BUFFER_POOL_SIZE = 10;    // size of buffer pool
 static constexpr int LRUK_REPLACER_K = 10;     // lookback window for lru-k replacer
+static constexpr int FRAME_ALIGNMENT = 4096;   // alignment of frame buffers, required by O_DIRECT
+static constexpr int CACHE_LINE_SIZE = 64;     // alignment of data written by different threads
+static constexpr double FLUSHER_DIRTY_RATIO = 0.1;  // background flusher keeps dirty frames below this ratio
+static constexpr int FLUSHER_BATCH_SIZE = 16;       // max pages written by the flusher before rechecking
+static constexpr int FLUSHER_INTERVAL_MS = 50;      // flusher wake up interval
+static constexpr double EVICTOR_LOW_WATERMARK = 0.05;  // evictor refills the free list below this ratio of frames
+static constexpr double EVICTOR_HIGH_WATERMARK = 0.1;  // evictor stops refilling at this ratio of frames
+static constexpr int READ_AHEAD_MIN_WINDOW = 2;   // leaves prefetched once a scan is found sequential
+static constexpr int READ_AHEAD_MAX_WINDOW = 32;  // upper bound of the adaptive read-ahead window
+static constexpr int PREFETCH_QUEUE_SIZE = 1024;  // capacity of the queue of pending prefetch requests
+static constexpr int RESIDENT_LEVELS = 2;          // tree levels kept pinned in the buffer pool, 0 to disable
+static constexpr int RESIDENT_CACHE_SIZE = 256;    // max pages pinned for the resident levels of one tree
+static constexpr int MAX_TREE_HEIGHT = 32;         // capacity of the path stacks of a tree operation
+static constexpr int QUERY_RESULT_INLINE_SIZE = 16;  // values of a point query held inline by its result vector
+static constexpr int EPOCH_SLOTS = 64;             // max threads inside an epoch at once
+static constexpr int EPOCH_RECLAIM_BATCH = 16;     // retired pages a thread piles up before reclaiming
+static constexpr int ACCESS_BUFFER_STRIPES = 16;   // rings of page hits waiting for the replacer
+static constexpr int ACCESS_BUFFER_SIZE = 32;      // page hits held by one ring
+static constexpr int TRACE_BUFFER_SIZE = 4096;     // access trace records written to the trace file at once
+static constexpr int COUNTER_STRIPES = 8;          // per-thread slots of a statistics counter
+static constexpr int MAX_BUFFER_POOL_SIZE = 1 << 18;  // frames of address space a buffer pool reserves to grow into
+static constexpr int RESIZE_CHUNK_SIZE = 64;           // frames released at once when a buffer pool shrinks
+static constexpr int RESIZE_TIMEOUT_MS = 1000;         // how long shrinking waits for pinned frames
+static constexpr int HUGE_PAGE_SIZE = 2 << 20;         // size of a huge page backing the frame arena
+static constexpr int FRAME_WAIT_TIMEOUT_MS = 1000;     // how long a fetch waits for a frame while all are pinned
+static constexpr int WARM_UP_BATCH = 64;               // saved hot pages queued for prefetch at once on startup
+static constexpr int WRITE_RUN_PAGES = 64;             // max consecutive pages written back by one pwritev
+static constexpr int MAX_FILES = 64;                   // files one buffer pool can serve
+static constexpr int INVALID_FILE_ID = -1;             // invalid file id
+static constexpr uint64_t INVALID_PAGE_KEY = ~0ULL;    // invalid page key
 
 using frame_id_t = int32_t;  // frame id type
 using page_id_t = int32_t;   // page id type
+using file_id_t = int32_t;   // file id type, the index of a file in its buffer pool
+using page_key_t = uint64_t;  // page id qualified by its file id, unique within a buffer pool
 }  // namespace CrazyDave
 #endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef BPT_PRO_STRIPED_COUNTER_H
+#define BPT_PRO_STRIPED_COUNTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include "common/config.h"
+
+namespace CrazyDave {
+
+/**
+ * StripedCounter is a statistics counter that threads bump without sharing a cache line.
+ *
+ * Each thread adds to one of COUNTER_STRIPES cache line sized slots, picked by its thread id, and Load() merges the
+ * slots. The sum is exact once the writers are done, and a consistent enough estimate while they are running.
+ */
+class StripedCounter {
+ public:
+  StripedCounter() = default;
+  StripedCounter(const StripedCounter &) = delete;
+  auto operator=(const StripedCounter &) -> StripedCounter & = delete;
+
+  void Add(size_t n = 1) {
+    static thread_local const size_t stripe_of_thread = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    stripes_[stripe_of_thread % COUNTER_STRIPES].value_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  auto Load() const -> size_t {
+    size_t sum = 0;
+    for (const auto &stripe : stripes_) {
+      sum += stripe.value_.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+ private:
+  struct alignas(CACHE_LINE_SIZE) Stripe {
+    std::atomic<size_t> value_{0};
+  };
+
+  Stripe stripes_[COUNTER_STRIPES];
+};
+
+}  // namespace CrazyDave
+
+#endif  // BPT_PRO_STRIPED_COUNTER_H
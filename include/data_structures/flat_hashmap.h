@@ -0,0 +1,332 @@
+#ifndef BPT_PRO_FLAT_HASHMAP_H
+#define BPT_PRO_FLAT_HASHMAP_H
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <utility>
+#include "common/utils.h"
+namespace CrazyDave {
+/**
+ * Open addressing hash map with Robin Hood probing, for small hot tables like the page table.
+ *
+ * Entries are stored inline in one slot array whose capacity is a power of two, next to a byte array holding
+ * 1 + the distance of each entry from its home slot (0 for an empty slot). Insertion lets an entry take the slot of
+ * a richer one (closer to its home), and erasure shifts the following entries back, so probe sequences stay short
+ * and lookups stop as soon as they meet an entry closer to home than the key would be. The table doubles when it is
+ * 7/8 full and never allocates per entry. A map moved from holds no table, it allocates one again when it is next
+ * inserted into.
+ *
+ * Inserting or erasing moves entries around: it invalidates every iterator, pointer and reference into the map.
+ */
+template <class Key, class T, class Hash = std::hash<Key>, class Equal = std::equal_to<Key> >
+class flat_hashmap {
+ public:
+  typedef pair<const Key, T> value_type;
+
+ private:
+  static constexpr size_t min_capacity = 16;
+
+  value_type *slots = nullptr;
+  uint8_t *dist = nullptr;
+  size_t capacity = 0;
+  size_t currentSize = 0;
+  int shift = 64;
+  Hash hash;
+  Equal equal;
+
+  size_t home(const Key &key) const {
+    // Fibonacci hashing, std::hash of integers is the identity and page ids are dense.
+    return static_cast<size_t>((static_cast<uint64_t>(hash(key)) * 0x9E3779B97F4A7C15ULL) >> shift);
+  }
+
+  size_t max_load() const { return capacity - (capacity >> 3); }
+
+  static void relocate(value_type *to, value_type *from) {
+    new (to) value_type(std::move(*from));
+    from->~value_type();
+  }
+
+  void allocate(size_t cap) {
+    capacity = cap;
+    shift = 64;
+    for (size_t c = cap; c > 1; c >>= 1) --shift;
+    slots = static_cast<value_type *>(::operator new(cap * sizeof(value_type), std::align_val_t(alignof(value_type))));
+    dist = new uint8_t[cap]();
+  }
+
+  void deallocate() {
+    ::operator delete(slots, std::align_val_t(alignof(value_type)));
+    delete[] dist;
+    slots = nullptr;
+    dist = nullptr;
+  }
+
+  /** Double the table, or allocate the first one of a map moved from. */
+  void grow() { rehash(capacity == 0 ? min_capacity : capacity << 1); }
+
+  void rehash(size_t cap) {
+    value_type *old_slots = slots;
+    uint8_t *old_dist = dist;
+    size_t old_capacity = capacity;
+    allocate(cap);
+    for (size_t i = 0; i < old_capacity; ++i) {
+      if (old_dist[i]) {
+        place(&old_slots[i]);
+      }
+    }
+    ::operator delete(old_slots, std::align_val_t(alignof(value_type)));
+    delete[] old_dist;
+  }
+
+  /**
+   * Robin Hood insertion of an entry known to be absent, moving it out of from and destroying it there.
+   * @return the slot the entry ends up in, or capacity if the table had to grow on the way
+   */
+  size_t place(value_type *from) {
+    alignas(value_type) unsigned char carry_buf[sizeof(value_type)];
+    alignas(value_type) unsigned char swap_buf[sizeof(value_type)];
+    auto *carry = reinterpret_cast<value_type *>(carry_buf);
+    auto *tmp = reinterpret_cast<value_type *>(swap_buf);
+    relocate(carry, from);
+    size_t pos = capacity;
+    size_t i = home(carry->first);
+    uint8_t d = 1;
+    while (true) {
+      if (dist[i] == 0) {
+        relocate(&slots[i], carry);
+        dist[i] = d;
+        return pos == capacity ? i : pos;
+      }
+      if (dist[i] < d) {
+        relocate(tmp, &slots[i]);
+        relocate(&slots[i], carry);
+        relocate(carry, tmp);
+        std::swap(dist[i], d);
+        if (pos == capacity) pos = i;
+      }
+      i = (i + 1) & (capacity - 1);
+      if (++d == UINT8_MAX) {
+        // Pathological clustering, grow and place the entry in hand into the new table.
+        grow();
+        place(carry);
+        return capacity;
+      }
+    }
+  }
+
+  size_t find_slot(const Key &key) const {
+    if (currentSize == 0) return capacity;
+    size_t i = home(key);
+    uint8_t d = 1;
+    while (dist[i] >= d) {
+      if (dist[i] == d && equal(slots[i].first, key)) return i;
+      i = (i + 1) & (capacity - 1);
+      ++d;
+    }
+    return capacity;
+  }
+
+  size_t next_used(size_t i) const {
+    while (i < capacity && !dist[i]) ++i;
+    return i;
+  }
+
+ public:
+  class const_iterator;
+  class iterator {
+    friend flat_hashmap;
+    friend const_iterator;
+
+   private:
+    flat_hashmap *map;
+    size_t pos;
+
+   public:
+    using difference_type = std::ptrdiff_t;
+    using value_type = typename flat_hashmap::value_type;
+    using pointer = value_type *;
+    using reference = value_type &;
+    using iterator_category = std::forward_iterator_tag;
+
+    explicit iterator(flat_hashmap *map = nullptr, size_t pos = 0) : map(map), pos(pos) {}
+
+    iterator operator++(int) {
+      iterator tmp = *this;
+      pos = map->next_used(pos + 1);
+      return tmp;
+    }
+
+    iterator &operator++() {
+      pos = map->next_used(pos + 1);
+      return *this;
+    }
+
+    value_type &operator*() const { return map->slots[pos]; }
+
+    value_type *operator->() const noexcept { return &map->slots[pos]; }
+
+    bool operator==(const iterator &rhs) const { return pos == rhs.pos; }
+
+    bool operator==(const const_iterator &rhs) const { return pos == rhs.pos; }
+
+    bool operator!=(const iterator &rhs) const { return pos != rhs.pos; }
+
+    bool operator!=(const const_iterator &rhs) const { return pos != rhs.pos; }
+  };
+
+  class const_iterator {
+    friend flat_hashmap;
+    friend iterator;
+
+   private:
+    const flat_hashmap *map;
+    size_t pos;
+
+   public:
+    explicit const_iterator(const flat_hashmap *map = nullptr, size_t pos = 0) : map(map), pos(pos) {}
+
+    const_iterator(const iterator &other) : map(other.map), pos(other.pos) {}
+
+    const_iterator operator++(int) {
+      const_iterator tmp = *this;
+      pos = map->next_used(pos + 1);
+      return tmp;
+    }
+
+    const_iterator &operator++() {
+      pos = map->next_used(pos + 1);
+      return *this;
+    }
+
+    const value_type &operator*() const { return map->slots[pos]; }
+
+    const value_type *operator->() const noexcept { return &map->slots[pos]; }
+
+    bool operator==(const iterator &rhs) const { return pos == rhs.pos; }
+
+    bool operator==(const const_iterator &rhs) const { return pos == rhs.pos; }
+
+    bool operator!=(const iterator &rhs) const { return pos != rhs.pos; }
+
+    bool operator!=(const const_iterator &rhs) const { return pos != rhs.pos; }
+  };
+
+  flat_hashmap() { allocate(min_capacity); }
+
+  /** @param expected number of entries the map should hold without growing */
+  explicit flat_hashmap(size_t expected) {
+    allocate(min_capacity);
+    reserve(expected);
+  }
+
+  flat_hashmap(const flat_hashmap &other) : hash(other.hash), equal(other.equal) {
+    allocate(other.capacity == 0 ? min_capacity : other.capacity);
+    for (auto it = other.cbegin(); it != other.cend(); ++it) insert(*it);
+  }
+
+  flat_hashmap(flat_hashmap &&other) noexcept
+      : slots(other.slots),
+        dist(other.dist),
+        capacity(other.capacity),
+        currentSize(other.currentSize),
+        shift(other.shift),
+        hash(std::move(other.hash)),
+        equal(std::move(other.equal)) {
+    other.slots = nullptr;
+    other.dist = nullptr;
+    other.capacity = 0;
+    other.currentSize = 0;
+  }
+
+  flat_hashmap &operator=(const flat_hashmap &other) {
+    if (this == &other) return *this;
+    clear();
+    reserve(other.currentSize);
+    for (auto it = other.cbegin(); it != other.cend(); ++it) insert(*it);
+    return *this;
+  }
+
+  ~flat_hashmap() {
+    clear();
+    deallocate();
+  }
+
+  /** Grow so that expected entries fit without a rehash. */
+  void reserve(size_t expected) {
+    size_t cap = capacity == 0 ? min_capacity : capacity;
+    while (cap - (cap >> 3) < expected) cap <<= 1;
+    if (cap != capacity) rehash(cap);
+  }
+
+  T &at(const Key &key) { return slots[find_slot(key)].second; }
+
+  const T &at(const Key &key) const { return slots[find_slot(key)].second; }
+
+  T &operator[](const Key &key) {
+    size_t i = find_slot(key);
+    if (i != capacity) return slots[i].second;
+    return insert(value_type(key, T{})).first->second;
+  }
+
+  iterator begin() { return iterator(this, next_used(0)); }
+
+  const_iterator begin() const { return const_iterator(this, next_used(0)); }
+
+  const_iterator cbegin() const { return const_iterator(this, next_used(0)); }
+
+  iterator end() { return iterator(this, capacity); }
+
+  const_iterator end() const { return const_iterator(this, capacity); }
+
+  const_iterator cend() const { return const_iterator(this, capacity); }
+
+  bool empty() const { return currentSize == 0; }
+
+  size_t size() const { return currentSize; }
+
+  void clear() {
+    for (size_t i = 0; i < capacity; ++i) {
+      if (dist[i]) {
+        slots[i].~value_type();
+        dist[i] = 0;
+      }
+    }
+    currentSize = 0;
+  }
+
+  pair<iterator, bool> insert(const value_type &value) {
+    size_t i = find_slot(value.first);
+    if (i != capacity) return {iterator(this, i), false};
+    if (currentSize + 1 > max_load()) grow();
+    alignas(value_type) unsigned char buf[sizeof(value_type)];
+    auto *entry = new (buf) value_type(value);
+    i = place(entry);
+    if (i == capacity) i = find_slot(value.first);
+    ++currentSize;
+    return {iterator(this, i), true};
+  }
+
+  /** Erase the entry at pos, shifting the entries probing past it one slot back. */
+  void erase(iterator pos) {
+    size_t i = pos.pos;
+    slots[i].~value_type();
+    size_t j = (i + 1) & (capacity - 1);
+    while (dist[j] > 1) {
+      relocate(&slots[i], &slots[j]);
+      dist[i] = dist[j] - 1;
+      i = j;
+      j = (j + 1) & (capacity - 1);
+    }
+    dist[i] = 0;
+    --currentSize;
+  }
+
+  size_t count(const Key &key) const { return find_slot(key) != capacity ? 1 : 0; }
+
+  iterator find(const Key &key) { return iterator(this, find_slot(key)); }
+
+  const_iterator find(const Key &key) const { return const_iterator(this, find_slot(key)); }
+};
+
+}  // namespace CrazyDave
+#endif  // BPT_PRO_FLAT_HASHMAP_H
@@ -0,0 +1,80 @@
+#ifndef BPT_PRO_INLINE_DEQUE_H
+#define BPT_PRO_INLINE_DEQUE_H
+#include <cstddef>
+#include <new>
+#include <utility>
+namespace CrazyDave {
+/**
+ * Fixed-capacity deque with inline storage, for short stacks like the path of a tree operation.
+ *
+ * Elements are pushed at the back and popped at either end, and never allocate. The live elements are contiguous,
+ * so iterators are plain pointers. When the back reaches the capacity the elements are moved down to the start of
+ * the storage, hence at most N elements may be alive at once, and pushing beyond that is undefined.
+ */
+template <class T, size_t N>
+class inline_deque {
+  alignas(T) unsigned char storage[N * sizeof(T)];
+  size_t first = 0;
+  size_t last = 0;
+
+  T *slot(size_t i) { return std::launder(reinterpret_cast<T *>(storage) + i); }
+  const T *slot(size_t i) const { return std::launder(reinterpret_cast<const T *>(storage) + i); }
+
+  void compact() {
+    for (size_t i = first; i < last; ++i) {
+      new (slot(i - first)) T(std::move(*slot(i)));
+      slot(i)->~T();
+    }
+    last -= first;
+    first = 0;
+  }
+
+ public:
+  typedef T *iterator;
+  typedef const T *const_iterator;
+
+  inline_deque() = default;
+  inline_deque(const inline_deque &) = delete;
+  inline_deque &operator=(const inline_deque &) = delete;
+  ~inline_deque() { clear(); }
+
+  T &front() { return *slot(first); }
+  const T &front() const { return *slot(first); }
+  T &back() { return *slot(last - 1); }
+  const T &back() const { return *slot(last - 1); }
+  T &operator[](size_t pos) { return *slot(first + pos); }
+  const T &operator[](size_t pos) const { return *slot(first + pos); }
+
+  iterator begin() { return slot(first); }
+  const_iterator begin() const { return slot(first); }
+  iterator end() { return slot(last); }
+  const_iterator end() const { return slot(last); }
+
+  bool empty() const { return first == last; }
+  size_t size() const { return last - first; }
+
+  void clear() {
+    while (!empty()) {
+      pop_back();
+    }
+    first = last = 0;
+  }
+
+  void push_back(T &&value) {
+    if (last == N) compact();
+    new (slot(last++)) T(std::move(value));
+  }
+  void push_back(const T &value) {
+    if (last == N) compact();
+    new (slot(last++)) T(value);
+  }
+  void pop_back() { slot(--last)->~T(); }
+  void pop_front() {
+    slot(first++)->~T();
+    if (first == last) first = last = 0;
+  }
+};
+
+}  // namespace CrazyDave
+
+#endif  // BPT_PRO_INLINE_DEQUE_H
@@ -1,6 +1,8 @@
 #ifndef BPT_PRO_LINKED_HASHMAP_HPP
 #define BPT_PRO_LINKED_HASHMAP_HPP
+#include <new>
 #include "common/utils.h"
+#include "data_structures/node_pool.h"
 namespace CrazyDave {
  template <class Key, class T, class Hash = std::hash<Key>, class Equal = std::equal_to<Key> >
  class linked_hashmap {
@@ -11,39 +13,35 @@ namespace CrazyDave {
    Equal equal;
 
    // 双链表节点
+   // The value is stored inline, and nodes come from the map's own node_pool.
    struct node {
      typedef pair<const Key, T> value_type;
-     value_type *val;
-     node *next;
-     node *prev;
+     node *next = nullptr;
+     node *prev = nullptr;
 
-     node *_next;
+     node *_next = nullptr;
 
-     explicit node(value_type v) {
-       val = new value_type(v);
-       next = nullptr;
-       prev = nullptr;
-       _next = nullptr;
-     }
-
-     node(value_type v, node *_n) {
-       val = new value_type(v);
-       _next = _n;
-       next = nullptr;
-       prev = nullptr;
-     }
+     alignas(value_type) unsigned char storage[sizeof(value_type)];
 
-     node() {
-       val = nullptr;
-       next = nullptr;
-       prev = nullptr;
-       _next = nullptr;
-     };
+     node() = default;  // the head and tail sentinels hold no value
 
-     ~node() { delete val; }
+     value_type *val() { return std::launder(reinterpret_cast<value_type *>(storage)); }
    };
 
+   node_pool<node> pool;
    node *head, *tail;
+
+   node *make_node(const typename node::value_type &v, node *_n = nullptr) {
+     node *p = pool.create();
+     new (p->storage) typename node::value_type(v);
+     p->_next = _n;
+     return p;
+   }
+
+   void free_node(node *p) {
+     p->val()->~value_type();
+     pool.destroy(p);
+   }
    node **array;  // 开散列表
    size_t get_hash(const Key &key) const { return hash(key) % capacity; }
 
@@ -99,7 +97,7 @@ namespace CrazyDave {
        return *this;
      }
 
-     value_type &operator*() const { return *(ptr->val); }
+     value_type &operator*() const { return *(ptr->val()); }
 
      bool operator==(const iterator &rhs) const { return ptr == rhs.ptr; }
 
@@ -109,7 +107,7 @@ namespace CrazyDave {
 
      bool operator!=(const const_iterator &rhs) const { return ptr != rhs.ptr; }
 
-     value_type *operator->() const noexcept { return ptr->val; }
+     value_type *operator->() const noexcept { return ptr->val(); }
    };
 
    class const_iterator {
@@ -161,7 +159,7 @@ namespace CrazyDave {
        return *this;
      }
 
-     const value_type &operator*() const { return *(ptr->val); }
+     const value_type &operator*() const { return *(ptr->val()); }
 
      bool operator==(const iterator &rhs) const { return ptr == rhs.ptr; }
 
@@ -171,12 +169,12 @@ namespace CrazyDave {
 
      bool operator!=(const const_iterator &rhs) const { return ptr != rhs.ptr; }
 
-     const value_type *operator->() const noexcept { return ptr->val; }
+     const value_type *operator->() const noexcept { return ptr->val(); }
    };
 
    linked_hashmap() {
-     head = new node;
-     tail = new node;
+     head = pool.create();
+     tail = pool.create();
      head->next = tail;
      tail->prev = head;
      currentSize = 0;
@@ -188,8 +186,8 @@ namespace CrazyDave {
    }
 
    linked_hashmap(const linked_hashmap &other) {
-     head = new node;
-     tail = new node;
+     head = pool.create();
+     tail = pool.create();
      head->next = tail;
      tail->prev = head;
      capacity = other.capacity;
@@ -202,11 +200,11 @@ namespace CrazyDave {
      node *q = other.head->next;
      size_t hs;
      while (q != other.tail) {
-       p = new node(*(q->val));
+       p = make_node(*(q->val()));
        p->next = tail;
        p->prev = tail->prev;
        tail->prev = tail->prev->next = p;
-       hs = get_hash(p->val->first);
+       hs = get_hash(p->val()->first);
        if (!array[hs]) {
          array[hs] = p;
        } else {
@@ -232,11 +230,11 @@ namespace CrazyDave {
      node *q = other.head->next;
      size_t hs;
      while (q != other.tail) {
-       p = new node(*(q->val));
+       p = make_node(*(q->val()));
        p->next = tail;
        p->prev = tail->prev;
        tail->prev = tail->prev->next = p;
-       hs = get_hash(p->val->first);
+       hs = get_hash(p->val()->first);
        if (!array[hs]) {
          array[hs] = p;
        } else {
@@ -253,48 +251,48 @@ namespace CrazyDave {
      node *p = head->next, *tmp;
      while (p != tail) {
        tmp = p->next;
-       delete p;
+       free_node(p);
        p = tmp;
      }
-     delete head;
-     delete tail;
+     pool.destroy(head);
+     pool.destroy(tail);
      delete[] array;
    }
 
    T &at(const Key &key) {
      size_t hs = get_hash(key);
      node *p = array[hs];
-     while (p && !equal(p->val->first, key)) p = p->_next;
+     while (p && !equal(p->val()->first, key)) p = p->_next;
 
-     return array[hs]->val->second;
+     return array[hs]->val()->second;
    }
 
    const T &at(const Key &key) const {
      size_t hs = get_hash(key);
      node *p = array[hs];
-     while (p && !equal(p->val->first, key)) p = p->_next;
+     while (p && !equal(p->val()->first, key)) p = p->_next;
 
-     return array[hs]->val->second;
+     return array[hs]->val()->second;
    }
 
    T &operator[](const Key &key) {
      size_t hs = get_hash(key);
      node *p = array[hs];
-     while (p && !equal(p->val->first, key)) p = p->_next;
+     while (p && !equal(p->val()->first, key)) p = p->_next;
      if (!p) {
        T t{};
        value_type v(key, t);
        auto pr = insert(v);
-       return pr.first.get_ptr()->val->second;
+       return pr.first.get_ptr()->val()->second;
      }
-     return p->val->second;
+     return p->val()->second;
    }
 
    const T &operator[](const Key &key) const {
      size_t hs = get_hash(key);
      node *p = array[hs];
-     while (p && !equal(p->val->first, key)) p = p->_next;
-     return p->val->second;
+     while (p && !equal(p->val()->first, key)) p = p->_next;
+     return p->val()->second;
    }
 
    iterator begin() {
@@ -325,7 +323,7 @@ namespace CrazyDave {
      node *p = head->next;
      while (p != tail) {
        node *tmp = p->next;
-       delete p;
+       free_node(p);
        p = tmp;
      }
      for (int i = 0; i < capacity; ++i) {
@@ -340,13 +338,13 @@ namespace CrazyDave {
      size_t hs = get_hash(value.first);
      node *p = array[hs];
 
-     while (p && !equal(p->val->first, value.first)) p = p->_next;
+     while (p && !equal(p->val()->first, value.first)) p = p->_next;
 
      if (p) {
        pair<iterator, bool> pr(iterator(p), false);
        return pr;
      } else {
-       p = array[hs] = new node(value, array[hs]);  // 插在头部
+       p = array[hs] = make_node(value, array[hs]);  // 插在头部
        p->next = tail;
        p->prev = tail->prev;
        tail->prev = tail->prev->next = p;
@@ -358,13 +356,13 @@ namespace CrazyDave {
 
    void erase(iterator pos) {
      node *p = pos.get_ptr();
-     size_t hs = get_hash(p->val->first);
+     size_t hs = get_hash(p->val()->first);
      node *q = array[hs];
      if (q == p) {
        p->prev->next = p->next;
        p->next->prev = p->prev;
        array[hs] = q->_next;
-       delete q;
+       free_node(q);
        --currentSize;
        return;
      }
@@ -374,14 +372,14 @@ namespace CrazyDave {
        p->next->prev = p->prev;
        q->_next = p->_next;
        --currentSize;
-       delete p;
+       free_node(p);
      }
    }
 
    size_t count(const Key &key) const {
      size_t hs = get_hash(key);
      node *p = array[hs];
-     while (p && !equal(p->val->first, key)) p = p->_next;
+     while (p && !equal(p->val()->first, key)) p = p->_next;
      if (p)
        return 1;
      else
@@ -391,7 +389,7 @@ namespace CrazyDave {
    iterator find(const Key &key) {
      size_t hs = get_hash(key);
      node *p = array[hs];
-     while (p && !equal(p->val->first, key)) p = p->_next;
+     while (p && !equal(p->val()->first, key)) p = p->_next;
 
      if (!p)
        return end();
@@ -402,7 +400,7 @@ namespace CrazyDave {
    const_iterator find(const Key &key) const {
      size_t hs = get_hash(key);
      node *p = array[hs];
-     while (p && !equal(p->val->first, key)) p = p->_next;
+     while (p && !equal(p->val()->first, key)) p = p->_next;
 
      if (!p)
        return cend();
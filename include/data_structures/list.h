@@ -1,27 +1,45 @@
 #ifndef BPT_PRO_LIST_H
 #define BPT_PRO_LIST_H
 #include <cstddef>
+#include <new>
+#include <utility>
+#include "data_structures/node_pool.h"
 namespace CrazyDave {
 template <typename T>
 class list {
  protected:
+  // Values are stored inline in the nodes, and nodes come from the list's own node_pool.
   class node {
    public:
-    T *data;
-    node *next;
-    node *prev;
-    node() {
-      next = prev = nullptr;
-      data = nullptr;
-    }
-    explicit node(T &&D, node *N = nullptr, node *P = nullptr) : next(N), prev(P) { data = new T(std::move(D)); }
-    explicit node(T &D, node *N = nullptr, node *P = nullptr) : next(N), prev(P) { data = new T(std::move(D)); }
-    ~node() { delete data; };
+    node *next = nullptr;
+    node *prev = nullptr;
+    alignas(T) unsigned char storage[sizeof(T)];
+    node() = default;  // the head and tail sentinels hold no value
+    T *data() { return std::launder(reinterpret_cast<T *>(storage)); }
   };
 
  protected:
+  node_pool<node> pool;
   node *head, *tail;
   int currentSize;
+
+  template <class... Args>
+  node *make_node(Args &&...args) {
+    node *n = pool.create();
+    new (n->storage) T(std::forward<Args>(args)...);
+    return n;
+  }
+  void free_node(node *n) {
+    n->data()->~T();
+    pool.destroy(n);
+  }
+  void init() {
+    head = pool.create();
+    tail = pool.create();
+    head->next = tail;
+    tail->prev = head;
+    currentSize = 0;
+  }
   node *insert(node *pos, node *cur) {
     cur->prev = pos->prev;
     cur->next = pos;
@@ -68,9 +86,9 @@ class list {
       return *this;
     }
 
-    T &operator*() const { return *(ptr->data); }
+    T &operator*() const { return *(ptr->data()); }
 
-    T *operator->() const noexcept { return ptr->data; }
+    T *operator->() const noexcept { return ptr->data(); }
 
     bool operator==(const iterator &rhs) const { return ptr == rhs.ptr; }
 
@@ -108,50 +126,59 @@ class list {
       ptr = ptr->prev;
       return *this;
     }
-    T &operator*() const { return *(ptr->data); }
-    T *operator->() const noexcept { return ptr->data; }
+    T &operator*() const { return *(ptr->data()); }
+    T *operator->() const noexcept { return ptr->data(); }
     bool operator==(const iterator &rhs) const { return ptr == rhs.ptr; }
     bool operator==(const const_iterator &rhs) const { return ptr == rhs.ptr; }
     bool operator!=(const iterator &rhs) const { return ptr != rhs.ptr; }
     bool operator!=(const const_iterator &rhs) const { return ptr != rhs.ptr; }
   };
-  list() {
-    head = new node;
-    tail = new node;
-    head->next = tail;
-    tail->prev = head;
-    currentSize = 0;
-  }
+  list() { init(); }
   list(const list &other) {
-    head = new node;
-    tail = new node;
-    head->next = tail;
-    tail->prev = head;
+    init();
     node *p = other.head->next;
     while (p != other.tail) {
-      push_back(*(p->data));
+      push_back(*(p->data()));
       p = p->next;
     }
-    currentSize = other.currentSize;
+  }
+  /** Steal the nodes of other. A moved-from list may only be destroyed or assigned to. */
+  list(list &&other) noexcept
+      : pool(std::move(other.pool)), head(other.head), tail(other.tail), currentSize(other.currentSize) {
+    other.head = other.tail = nullptr;
+    other.currentSize = 0;
   }
   virtual ~list() {
+    if (head == nullptr) {
+      return;
+    }
     clear();
-    delete head;
-    delete tail;
+    pool.destroy(head);
+    pool.destroy(tail);
   }
   list &operator=(const list &other) {
     if (this == &other) return *this;
-    clear();
+    if (head == nullptr) {
+      init();  // moved from, the sentinels went with the nodes
+    } else {
+      clear();
+    }
     node *p = other.head->next;
     while (p != other.tail) {
-      push_back(*(p->data));
+      push_back(*(p->data()));
       p = p->next;
     }
-    currentSize = other.currentSize;
     return *this;
   }
-  T &front() const { return *(head->next->data); }
-  T &back() const { return *(tail->prev->data); }
+  list &operator=(list &&other) noexcept {
+    pool.swap(other.pool);
+    std::swap(head, other.head);
+    std::swap(tail, other.tail);
+    std::swap(currentSize, other.currentSize);
+    return *this;
+  }
+  T &front() const { return *(head->next->data()); }
+  T &back() const { return *(tail->prev->data()); }
   iterator begin() {
     iterator itr(head->next);
     return itr;
@@ -177,61 +204,25 @@ class list {
     }
   }
 
-  virtual iterator insert(iterator pos, T &value) {
-    node *tmp = new node(value, pos.ptr, pos.ptr->prev);
-    pos.ptr->prev = pos.ptr->prev->next = tmp;
-    ++currentSize;
-    pos.ptr = tmp;
+  virtual iterator insert(iterator pos, const T &value) {
+    pos.ptr = insert(pos.ptr, make_node(value));
     return pos;
   }
   virtual iterator insert(iterator pos, T &&value) {
-    node *tmp = new node(value, pos.ptr, pos.ptr->prev);
-    pos.ptr->prev = pos.ptr->prev->next = tmp;
-    ++currentSize;
-    pos.ptr = tmp;
+    pos.ptr = insert(pos.ptr, make_node(std::move(value)));
     return pos;
   }
   virtual iterator erase(iterator pos) {
-    pos.ptr->prev->next = pos.ptr->next;
-    pos.ptr->next->prev = pos.ptr->prev;
     node *tmp = pos.ptr->next;
-    delete pos.ptr;
+    free_node(erase(pos.ptr));
     pos.ptr = tmp;
-    --currentSize;
     return pos;
   }
-  void push_back(T &value) {
-    node *tmp = new node(value, tail, tail->prev);
-    tail->prev->next = tmp;
-    tail->prev = tmp;
-    ++currentSize;
-  }
-  void push_back(T &&value) {
-    node *tmp = new node(std::move(value), tail, tail->prev);
-    tail->prev->next = tmp;
-    tail->prev = tmp;
-    ++currentSize;
-  }
-  void pop_back() {
-    node *tmp = tail->prev;
-    tmp->prev->next = tail;
-    tail->prev = tmp->prev;
-    delete tmp;
-    --currentSize;
-  }
-  void push_front(T &value) {
-    node *tmp = new node(value, head->next, head);
-    head->next->prev = tmp;
-    head->next = tmp;
-    ++currentSize;
-  }
-  void pop_front() {
-    node *tmp = head->next;
-    tmp->next->prev = head;
-    head->next = tmp->next;
-    delete tmp;
-    --currentSize;
-  }
+  void push_back(const T &value) { insert(tail, make_node(value)); }
+  void push_back(T &&value) { insert(tail, make_node(std::move(value))); }
+  void pop_back() { free_node(erase(tail->prev)); }
+  void push_front(const T &value) { insert(head->next, make_node(value)); }
+  void pop_front() { free_node(erase(head->next)); }
 };
 
 }  // namespace CrazyDave
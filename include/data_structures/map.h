@@ -3,7 +3,9 @@
 
 #include <cstddef>
 #include <functional>
+#include <new>
 #include "common/utils.h"
+#include "data_structures/node_pool.h"
 
 namespace CrazyDave {
 template <class Key, class T, class Compare = std::less<Key>>
@@ -13,23 +15,22 @@ class map {
   enum Color { RED, BLACK };
 
  private:
+  // The value is stored inline, and nodes come from the map's own node_pool.
   struct TreeNode {
-    value_type *data = nullptr;
+    alignas(value_type) unsigned char storage[sizeof(value_type)];
     TreeNode *left = nullptr;
     TreeNode *right = nullptr;
     TreeNode *fa = nullptr;
     Color color = RED;
 
-    TreeNode() = default;
+    TreeNode() = default;  // the past-the-end node holds no value
 
-    TreeNode(const value_type &_data, TreeNode *_left, TreeNode *_right, Color _color = RED)
-        : left(_left), right(_right), color(_color) {
-      data = new value_type{_data};
-    }
+    explicit TreeNode(Color _color) : color(_color) {}
 
-    ~TreeNode() { delete data; }
+    value_type *data() { return std::launder(reinterpret_cast<value_type *>(storage)); }
   };
 
+  node_pool<TreeNode> pool;
   TreeNode *root = nullptr;
   TreeNode *head = nullptr;
   TreeNode *tail = nullptr;
@@ -37,6 +38,17 @@ class map {
   size_t num = 0;
   Compare cmp;
 
+  TreeNode *make_node(const value_type &val, Color color) {
+    TreeNode *n = pool.create(color);
+    new (n->storage) value_type(val);
+    return n;
+  }
+
+  void free_node(TreeNode *n) {
+    n->data()->~value_type();
+    pool.destroy(n);
+  }
+
   void swap_tree_node(TreeNode *n1, TreeNode *n2) {
     if (root == n1) {
       root = n2;
@@ -244,7 +256,7 @@ class map {
   }
 
   void copy(TreeNode *&n, TreeNode *_n, const map &_mp) {
-    n = new TreeNode{*(_n->data), nullptr, nullptr, _n->color};
+    n = make_node(*(_n->data()), _n->color);
     if (_n == _mp.head) {
       head = n;
     }
@@ -268,7 +280,7 @@ class map {
     if (n->right) {
       destroy(n->right);
     }
-    delete n;
+    free_node(n);
   }
 
  public:
@@ -366,7 +378,7 @@ class map {
       return *this;
     }
 
-    value_type &operator*() const { return *(n->data); }
+    value_type &operator*() const { return *(n->data()); }
 
     bool operator==(const iterator &rhs) const { return n == rhs.n; }
 
@@ -376,7 +388,7 @@ class map {
 
     bool operator!=(const const_iterator &rhs) const { return n != rhs.n; }
 
-    value_type *operator->() const noexcept { return n->data; }
+    value_type *operator->() const noexcept { return n->data(); }
   };
 
   class const_iterator {
@@ -473,7 +485,7 @@ class map {
       return *this;
     }
 
-    value_type &operator*() const { return *(n->data); }
+    value_type &operator*() const { return *(n->data()); }
 
     bool operator==(const iterator &rhs) const { return n == rhs.n; }
 
@@ -483,13 +495,13 @@ class map {
 
     bool operator!=(const const_iterator &rhs) const { return n != rhs.n; }
 
-    value_type *operator->() const noexcept { return n->data; }
+    value_type *operator->() const noexcept { return n->data(); }
   };
 
-  map() { pe = new TreeNode; }
+  map() { pe = pool.create(); }
 
   map(const map &other) {
-    pe = new TreeNode;
+    pe = pool.create();
     num = other.num;
     if (!other.empty()) {
       copy(root, other.root, other);
@@ -501,8 +513,6 @@ class map {
       return *this;
     }
     clear();
-    delete pe;
-    pe = new TreeNode;
     num = other.num;
     if (!other.empty()) {
       copy(root, other.root, other);
@@ -512,7 +522,7 @@ class map {
 
   ~map() {
     clear();
-    delete pe;
+    pool.destroy(pe);
   }
 
   T &at(const Key &key) {
@@ -570,7 +580,7 @@ class map {
 
   pair<iterator, bool> insert(const value_type &val) {
     if (root == nullptr) {
-      head = tail = root = new TreeNode{val, nullptr, nullptr, BLACK};
+      head = tail = root = make_node(val, BLACK);
       ++num;
       iterator it{root, this};
       return {it, true};
@@ -579,8 +589,8 @@ class map {
     n = pa = root;
     while (true) {  // Top-down method
       if (n == nullptr) {
-        n = new TreeNode{val, nullptr, nullptr, RED};
-        if (cmp(n->data->first, pa->data->first)) {
+        n = make_node(val, RED);
+        if (cmp(n->data()->first, pa->data()->first)) {
           pa->left = n;
           if (head == pa) {
             head = n;
@@ -609,9 +619,9 @@ class map {
         }
       }
       pa = n;
-      if (cmp(val.first, n->data->first)) {
+      if (cmp(val.first, n->data()->first)) {
         n = n->left;
-      } else if (cmp(n->data->first, val.first)) {
+      } else if (cmp(n->data()->first, val.first)) {
         n = n->right;
       } else {  // n->data->first equals to val.first
         iterator it{n, this};
@@ -644,7 +654,7 @@ class map {
     // Leaf node.
     --num;
     if (n == root) {
-      delete root;
+      free_node(root);
       root = head = tail = nullptr;
       return;
     }
@@ -731,7 +741,7 @@ class map {
       }
       pa->right = nullptr;
     }
-    delete n;
+    free_node(n);
   }
 
   size_t count(const Key &key) const { return find(key) != end(); }
@@ -745,9 +755,9 @@ class map {
       if (n == nullptr) {
         return end();
       }
-      if (cmp(key, n->data->first)) {
+      if (cmp(key, n->data()->first)) {
         n = n->left;
-      } else if (cmp(n->data->first, key)) {
+      } else if (cmp(n->data()->first, key)) {
         n = n->right;
       } else {
         return {n, this};
@@ -764,9 +774,9 @@ class map {
       if (n == nullptr) {
         return cend();
       }
-      if (cmp(key, n->data->first)) {
+      if (cmp(key, n->data()->first)) {
         n = n->left;
-      } else if (cmp(n->data->first, key)) {
+      } else if (cmp(n->data()->first, key)) {
         n = n->right;
       } else {
         return {n, this};
@@ -0,0 +1,102 @@
+#ifndef BPT_PRO_NODE_POOL_H
+#define BPT_PRO_NODE_POOL_H
+#include <cstddef>
+#include <new>
+#include <utility>
+namespace CrazyDave {
+/**
+ * Slab allocator for the nodes of one container.
+ *
+ * Nodes are carved out of chunks that start at MIN_CHUNK nodes and double up to MAX_CHUNK, and freed nodes are kept
+ * on an intrusive free list for reuse, so a container that stays around its peak size stops allocating altogether.
+ * Nodes of a container also end up next to each other, which makes walking it cheaper. The chunks are only
+ * returned when the pool is destroyed.
+ *
+ * A pool is not thread safe, it is owned by a single container and shares its synchronization.
+ */
+template <class Node>
+class node_pool {
+  static constexpr size_t MIN_CHUNK = 8;
+  static constexpr size_t MAX_CHUNK = 256;
+
+  union slot {
+    slot *next_free;
+    alignas(Node) unsigned char bytes[sizeof(Node)];
+  };
+
+  struct chunk {
+    chunk *next;
+    size_t count;
+    slot *slots();
+  };
+  /** Chunk header size rounded up to the slot alignment, the slots follow it. */
+  static constexpr size_t HEADER = (sizeof(chunk) + alignof(slot) - 1) / alignof(slot) * alignof(slot);
+  static constexpr std::align_val_t CHUNK_ALIGN{alignof(slot) > alignof(chunk) ? alignof(slot) : alignof(chunk)};
+
+  chunk *chunks = nullptr;
+  slot *free_slots = nullptr;
+  size_t next_chunk = MIN_CHUNK;
+
+  void grow() {
+    auto *c = static_cast<chunk *>(::operator new(HEADER + next_chunk * sizeof(slot), CHUNK_ALIGN));
+    c->next = chunks;
+    c->count = next_chunk;
+    chunks = c;
+    // Thread the new slots onto the free list in address order.
+    slot *s = c->slots();
+    for (size_t i = c->count; i-- > 0;) {
+      s[i].next_free = free_slots;
+      free_slots = &s[i];
+    }
+    if (next_chunk < MAX_CHUNK) next_chunk <<= 1;
+  }
+
+ public:
+  node_pool() = default;
+  node_pool(const node_pool &) = delete;
+  node_pool &operator=(const node_pool &) = delete;
+  node_pool(node_pool &&other) noexcept { swap(other); }
+  node_pool &operator=(node_pool &&other) noexcept {
+    swap(other);
+    return *this;
+  }
+  ~node_pool() {
+    while (chunks) {
+      chunk *c = chunks;
+      chunks = c->next;
+      ::operator delete(c, CHUNK_ALIGN);
+    }
+  }
+
+  void swap(node_pool &other) noexcept {
+    std::swap(chunks, other.chunks);
+    std::swap(free_slots, other.free_slots);
+    std::swap(next_chunk, other.next_chunk);
+  }
+
+  /** Construct a node in a free slot. */
+  template <class... Args>
+  Node *create(Args &&...args) {
+    if (!free_slots) grow();
+    slot *s = free_slots;
+    free_slots = s->next_free;
+    return new (s->bytes) Node(std::forward<Args>(args)...);
+  }
+
+  /** Destroy a node created by this pool and give its slot back. */
+  void destroy(Node *n) {
+    n->~Node();
+    auto *s = reinterpret_cast<slot *>(n);
+    s->next_free = free_slots;
+    free_slots = s;
+  }
+};
+
+template <class Node>
+typename node_pool<Node>::slot *node_pool<Node>::chunk::slots() {
+  return reinterpret_cast<slot *>(reinterpret_cast<unsigned char *>(this) + HEADER);
+}
+
+}  // namespace CrazyDave
+
+#endif  // BPT_PRO_NODE_POOL_H
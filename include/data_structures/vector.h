@@ -1,26 +1,107 @@
 #ifndef SJTU_VECTOR_HPP
 #define SJTU_VECTOR_HPP
 
+#include <cstring>
 #include <memory>
+#include <type_traits>
+#include <utility>
 namespace CrazyDave {
+/** Inline element storage of vector, empty when there is none. */
+template <typename T, size_t N>
+struct vector_inline_storage {
+  alignas(T) unsigned char bytes[N * sizeof(T)];
+  T *get() { return reinterpret_cast<T *>(bytes); }
+  const T *get() const { return reinterpret_cast<const T *>(bytes); }
+};
 template <typename T>
+struct vector_inline_storage<T, 0> {
+  T *get() { return nullptr; }
+  const T *get() const { return nullptr; }
+};
+
+/**
+ * Dynamic array. With InlineN > 0 the first InlineN elements live inside the vector object itself, so short
+ * vectors, like the results of a point query, never touch the heap. Nothing is allocated before the first insertion.
+ */
+template <typename T, size_t InlineN = 0>
 class vector {
  private:
   T *data;
   std::allocator<T> alloc;
   size_t currentSize;
   size_t capacity;
+  [[no_unique_address]] vector_inline_storage<T, InlineN> small;
 
-  void double_space() {
+  bool is_inline() const { return InlineN > 0 && data == small.get(); }
+
+  /** Move the elements into a buffer of new_capacity, which is the inline storage if it fits. */
+  void reallocate(size_t new_capacity) {
     T *tmp = data;
-    data = alloc.allocate(capacity * 2);
-    for (int i = 0; i < (int)currentSize; ++i) {
-      std::construct_at(data + i, tmp[i]);
-      (tmp + i)->~T();
+    bool was_inline = is_inline();
+    size_t old_capacity = capacity;
+    if (new_capacity <= InlineN) {
+      data = small.get();
+      new_capacity = InlineN;
+    } else {
+      data = alloc.allocate(new_capacity);
+    }
+    if (tmp == data) {
+      return;
+    }
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      if (currentSize > 0) {
+        memcpy(static_cast<void *>(data), static_cast<const void *>(tmp), currentSize * sizeof(T));
+      }
+    } else {
+      for (size_t i = 0; i < currentSize; ++i) {
+        std::construct_at(data + i, std::move(tmp[i]));
+        (tmp + i)->~T();
+      }
+    }
+    if (tmp != nullptr && !was_inline) {
+      alloc.deallocate(tmp, old_capacity);
+    }
+    capacity = new_capacity;
+  }
+
+  void double_space() { reallocate(capacity == 0 ? 8 : capacity * 2); }
+
+  void destroy_all() {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      for (size_t i = 0; i < currentSize; ++i) {
+        (data + i)->~T();
+      }
     }
-    alloc.deallocate(tmp, capacity);
-    capacity <<= 1;
+    currentSize = 0;
+  }
+
+  void release() {
+    destroy_all();
+    if (data != nullptr && !is_inline()) {
+      alloc.deallocate(data, capacity);
+    }
+    data = small.get();
+    capacity = InlineN;
+  }
+
+  /** Take the elements of other, adopting its heap buffer if it has one. */
+  void steal(vector &other) {
+    if (other.data != nullptr && !other.is_inline()) {
+      data = other.data;
+      capacity = other.capacity;
+      currentSize = other.currentSize;
+    } else {
+      for (size_t i = 0; i < other.currentSize; ++i) {
+        std::construct_at(data + i, std::move(other.data[i]));
+        (other.data + i)->~T();
+      }
+      currentSize = other.currentSize;
+    }
+    other.data = other.small.get();
+    other.capacity = InlineN;
+    other.currentSize = 0;
   }
+
   void quick_sort(T *arr, int len, bool cmp(const T &, const T &)) {
     if (len <= 1) {
       return;
@@ -43,14 +124,14 @@ class vector {
   class const_iterator;
 
   class iterator {
-    friend vector<T>;
+    friend vector;
 
    private:
     T *ptr;
-    vector<T> *vec;
+    vector *vec;
 
    public:
-    explicit iterator(T *ptr = nullptr, vector<T> *vec = nullptr) : ptr(ptr), vec(vec) {}
+    explicit iterator(T *ptr = nullptr, vector *vec = nullptr) : ptr(ptr), vec(vec) {}
     iterator operator++(int) {
       iterator tmp = *this;
       ++ptr;
@@ -69,7 +150,10 @@ class vector {
       --ptr;
       return *this;
     }
+    iterator operator+(std::ptrdiff_t n) const { return iterator(ptr + n, vec); }
+    iterator operator-(std::ptrdiff_t n) const { return iterator(ptr - n, vec); }
     T &operator*() const { return *ptr; }
+    T *operator->() const { return ptr; }
     bool operator==(const iterator &rhs) const { return ptr == rhs.ptr; }
     bool operator==(const const_iterator &rhs) const { return ptr == rhs.ptr; }
     bool operator!=(const iterator &rhs) const { return !(rhs == *this); }
@@ -77,14 +161,14 @@ class vector {
   };
 
   class const_iterator {
-    friend vector<T>;
+    friend vector;
 
    private:
     T *ptr;
-    const vector<T> *vec;
+    const vector *vec;
 
    public:
-    explicit const_iterator(T *ptr = nullptr, const vector<T> *vec = nullptr) : ptr(ptr), vec(vec) {}
+    explicit const_iterator(T *ptr = nullptr, const vector *vec = nullptr) : ptr(ptr), vec(vec) {}
     const_iterator operator++(int) {
       const_iterator tmp = *this;
       ++ptr;
@@ -110,47 +194,49 @@ class vector {
     bool operator!=(const const_iterator &rhs) const { return !(rhs == *this); }
   };
 
-  vector() {
-    data = alloc.allocate(10);
-    capacity = 10;
-    currentSize = 0;
-  }
+  // data is pointed at small in the constructor bodies: small is declared after it, and its bytes are left
+  // uninitialized on purpose.
+  vector() : currentSize(0), capacity(InlineN) { data = small.get(); }
 
-  vector(const vector &other) {
-    currentSize = other.currentSize;
-    capacity = other.capacity;
-    data = alloc.allocate(capacity);
-    for (int i = 0; i < (int)currentSize; ++i) {
+  vector(const vector &other) : currentSize(0), capacity(InlineN) {
+    data = small.get();
+    reserve(other.currentSize);
+    for (size_t i = 0; i < other.currentSize; ++i) {
       std::construct_at(data + i, other.data[i]);
     }
+    currentSize = other.currentSize;
   }
 
-  ~vector() {
-    for (int i = 0; i < (int)currentSize; ++i) {
-      (data + i)->~T();
-    }
-    alloc.deallocate(data, capacity);
+  vector(vector &&other) noexcept : currentSize(0), capacity(InlineN) {
+    data = small.get();
+    steal(other);
   }
+
+  ~vector() { release(); }
+
   vector &operator=(const vector &other) {
     if (&other == this) return *this;
-    for (int i = 0; i < (int)currentSize; ++i) {
-      (data + i)->~T();
-    }
-    alloc.deallocate(data, capacity);
-    currentSize = other.currentSize;
-    capacity = other.capacity;
-    data = alloc.allocate(capacity);
-    for (int i = 0; i < (int)currentSize; ++i) {
+    destroy_all();
+    reserve(other.currentSize);
+    for (size_t i = 0; i < other.currentSize; ++i) {
       std::construct_at(data + i, other.data[i]);
     }
-
+    currentSize = other.currentSize;
+    return *this;
+  }
+  vector &operator=(vector &&other) noexcept {
+    if (&other == this) return *this;
+    release();
+    steal(other);
     return *this;
   }
   T &at(const size_t &pos) { return data[pos]; }
   const T &at(const size_t &pos) const { return data[pos]; }
   T &operator[](const size_t &pos) { return data[pos]; }
   const T &operator[](const size_t &pos) const { return data[pos]; }
+  T &front() { return data[0]; }
   const T &front() const { return data[0]; }
+  T &back() { return data[currentSize - 1]; }
   const T &back() const { return data[currentSize - 1]; }
   iterator begin() {
     iterator itr(data, this);
@@ -170,51 +256,73 @@ class vector {
   }
   [[nodiscard]] bool empty() const { return currentSize == 0; }
   [[nodiscard]] size_t size() const { return currentSize; }
-  void clear() {
-    for (int i = 0; i < (int)capacity; ++i) {
-      (data + i)->~T();
+  /** Destroy the elements but keep the storage, use shrink_to_fit() to give it back. */
+  void clear() { destroy_all(); }
+  /** Make room for n elements without further allocation. */
+  void reserve(size_t n) {
+    if (n > capacity) reallocate(n);
+  }
+  /** Shrink the storage to the size, moving the elements back inline when they fit. */
+  void shrink_to_fit() {
+    if (currentSize == 0 && InlineN == 0) {
+      release();
+    } else if (currentSize < capacity && !is_inline()) {
+      reallocate(currentSize);
     }
-    alloc.deallocate(data, capacity);
-    data = alloc.allocate(10);
-    currentSize = 0;
-    capacity = 10;
   }
   iterator insert(iterator pos, const T &value) {
+    size_t ind = pos.ptr - data;
     if (currentSize == capacity) {
-      int ind = pos.ptr - data;
+      T copy(value);
       double_space();
-      pos.ptr = data + ind;
+      return insert(iterator(data + ind, this), copy);
     }
-    iterator tmp = end() + 1;
-    for (; tmp != pos; --tmp) {
-      *tmp = *(tmp - 1);
+    if (ind == currentSize) {
+      std::construct_at(data + currentSize, value);
+    } else {
+      std::construct_at(data + currentSize, std::move(data[currentSize - 1]));
+      for (size_t i = currentSize - 1; i > ind; --i) {
+        data[i] = std::move(data[i - 1]);
+      }
+      data[ind] = value;
     }
-    *tmp = value;
     ++currentSize;
-    return tmp;
-  }
-  iterator insert(const size_t &ind, const T &value) {
-    iterator itr(data + ind, this);
-    insert(itr, value);
+    return iterator(data + ind, this);
   }
+  iterator insert(const size_t &ind, const T &value) { return insert(iterator(data + ind, this), value); }
+  /** Erase the element at pos, erasing end() drops the last element as pop_back() does. */
   iterator erase(iterator pos) {
     if (pos == end()) {
       pop_back();
       return end();
     }
-    for (; pos != end(); ++pos) {
-      *pos = *(pos + 1);
+    for (T *p = pos.ptr; p + 1 != data + currentSize; ++p) {
+      *p = std::move(*(p + 1));
     }
-    --currentSize;
+    pop_back();
     return pos;
   }
-  iterator erase(const size_t &ind) {
-    iterator itr(data + ind, this);
-    erase(itr);
-  }
+  iterator erase(const size_t &ind) { return erase(iterator(data + ind, this)); }
   void push_back(const T &value) {
-    if (currentSize == capacity) double_space();
-    std::construct_at(data + currentSize, value);
+    if (currentSize == capacity) {
+      // value may be an element of this vector, copy it before the storage moves.
+      T copy(value);
+      double_space();
+      std::construct_at(data + currentSize, std::move(copy));
+    } else {
+      std::construct_at(data + currentSize, value);
+    }
+    ++currentSize;
+  }
+  void push_back(T &&value) {
+    if (currentSize == capacity) {
+      // value may be an element of this vector too, move it out before the storage moves.
+      T tmp(std::move(value));
+      double_space();
+      std::construct_at(data + currentSize, std::move(tmp));
+    } else {
+      std::construct_at(data + currentSize, std::move(value));
+    }
     ++currentSize;
   }
   void pop_back() {
@@ -1,67 +1,204 @@
 #ifndef BPT_PRO_CONCURRENT_LIST_H
 #define BPT_PRO_CONCURRENT_LIST_H
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "common/config.h"
 
 /**
- * A bounded, lock-free, concurrent queue for garbage collection.
- * Based on ring buffer method and CAS, multiple producer and multiple consumer (aka. MPMC) is available.
+ * A bounded, lock-free, concurrent queue for handing work over to background threads, e.g. prefetch requests or
+ * pages to be reclaimed. Multiple producer and multiple consumer (aka. MPMC) is available.
+ *
+ * Based on Dmitry Vyukov's bounded MPMC queue: every slot carries a sequence number telling whose turn it is. A
+ * producer may write slot pos % capacity once its sequence equals pos, and publishes the value by setting it to
+ * pos + 1. A consumer may read it once the sequence equals pos + 1, and hands the slot to the producer of the next
+ * lap by setting it to pos + capacity. Positions are claimed by CAS on head_ / tail_, which live on their own cache
+ * lines so that producers and consumers do not contend on the same line.
+ *
+ * push() and pop() never block. push_wait() and pop_wait() sleep on a futex (std::atomic::wait) while the queue is
+ * full or empty, until close() is called.
  */
 
 namespace CrazyDave {
 template <class T, const int capacity>
 class ConcurrentQueue {
+  static_assert(capacity > 0);
+
  private:
-  T buffer_[capacity];
-  std::atomic<size_t> head_{0};
-  std::atomic<size_t> tail_{0};
+  struct Slot {
+    std::atomic<size_t> sequence_;
+    T value_;
+  };
+
+  Slot buffer_[capacity];
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_{0};
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_{0};
+  /** Bumped after every successful push / pop, the futex words blocked consumers / producers sleep on. */
+  alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> pushes_{0};
+  std::atomic<uint32_t> pops_{0};
+  std::atomic<int> pop_waiters_{0};
+  std::atomic<int> push_waiters_{0};
+  std::atomic<bool> closed_{false};
+
+  static auto Diff(size_t a, size_t b) -> intptr_t { return static_cast<intptr_t>(a - b); }
+
+  void Pushed() {
+    pushes_.fetch_add(1);
+    if (pop_waiters_.load() > 0) {
+      pushes_.notify_all();
+    }
+  }
+
+  void Popped() {
+    pops_.fetch_add(1);
+    if (push_waiters_.load() > 0) {
+      pops_.notify_all();
+    }
+  }
+
+  /**
+   * Claim up to max consecutive positions starting at the current head or tail.
+   * @param index head_ or tail_
+   * @param lag the sequence of a slot ready for us is its position plus lag
+   * @return number of positions claimed, starting at *pos
+   */
+  auto Claim(std::atomic<size_t> &index, size_t lag, size_t max, size_t *pos) -> size_t {
+    size_t current = index.load(std::memory_order_relaxed);
+    while (true) {
+      size_t n = 0;
+      while (n < max) {
+        size_t seq = buffer_[(current + n) % capacity].sequence_.load(std::memory_order_acquire);
+        if (Diff(seq, current + n + lag) != 0) {
+          break;
+        }
+        ++n;
+      }
+      if (n == 0) {
+        size_t seq = buffer_[current % capacity].sequence_.load(std::memory_order_acquire);
+        if (Diff(seq, current + lag) < 0) {
+          return 0;  // full (for producers) or empty (for consumers)
+        }
+        // Somebody else claimed current already.
+        current = index.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (index.compare_exchange_weak(current, current + n, std::memory_order_relaxed, std::memory_order_relaxed)) {
+        *pos = current;
+        return n;
+      }
+    }
+  }
 
  public:
-  ConcurrentQueue() = default;
+  ConcurrentQueue() {
+    for (size_t i = 0; i < static_cast<size_t>(capacity); ++i) {
+      buffer_[i].sequence_.store(i, std::memory_order_relaxed);
+    }
+  }
   ~ConcurrentQueue() = default;
+  ConcurrentQueue(const ConcurrentQueue &) = delete;
+  auto operator=(const ConcurrentQueue &) -> ConcurrentQueue & = delete;
+
+  /** @return false if the queue is full */
+  auto push(const T &value) -> bool { return push_bulk(&value, 1) == 1; }
 
-  auto push(const T &value) -> bool {
-    size_t current_tail = tail_.load(std::memory_order_relaxed);
-    size_t next_tail = (current_tail + 1) % capacity;
-    if (next_tail == head_.load(std::memory_order_acquire)) {
-      return false;
+  /** @return false if the queue is empty */
+  auto pop(T &value) -> bool { return pop_bulk(&value, 1) == 1; }
+
+  /**
+   * Push a prefix of values with a single claim.
+   * @return number of values pushed, 0 if the queue is full
+   */
+  auto push_bulk(const T *values, size_t count) -> size_t {
+    size_t pos;
+    size_t n = Claim(tail_, 0, count, &pos);
+    for (size_t i = 0; i < n; ++i) {
+      auto &slot = buffer_[(pos + i) % capacity];
+      slot.value_ = values[i];
+      slot.sequence_.store(pos + i + 1, std::memory_order_release);
     }
-    while (
-        !tail_.compare_exchange_weak(current_tail, next_tail, std::memory_order_acq_rel, std::memory_order_relaxed)) {
-      next_tail = (current_tail + 1) % capacity;
-      if (next_tail == head_.load(std::memory_order_acquire)) {
-        return false;
-      }
+    if (n > 0) {
+      Pushed();
     }
-    buffer_[current_tail] = value;
-    return true;
+    return n;
   }
 
-  auto pop(T &value) -> bool {
-    size_t current_head = head_.load(std::memory_order_relaxed);
-    if (current_head == tail_.load(std::memory_order_acquire)) {
-      return false;
+  /**
+   * Pop up to count values with a single claim, in queue order.
+   * @return number of values popped, 0 if the queue is empty
+   */
+  auto pop_bulk(T *values, size_t count) -> size_t {
+    size_t pos;
+    size_t n = Claim(head_, 1, count, &pos);
+    for (size_t i = 0; i < n; ++i) {
+      auto &slot = buffer_[(pos + i) % capacity];
+      values[i] = std::move(slot.value_);
+      slot.sequence_.store(pos + i + capacity, std::memory_order_release);
+    }
+    if (n > 0) {
+      Popped();
     }
-    size_t next_head = (current_head + 1) % capacity;
-    while (
-        !head_.compare_exchange_weak(current_head, next_head, std::memory_order_acq_rel, std::memory_order_relaxed)) {
-      current_head = head_.load(std::memory_order_relaxed);
-      if (current_head == tail_.load(std::memory_order_acquire)) {
-        return false;
+    return n;
+  }
+
+  /**
+   * Push, sleeping while the queue is full.
+   * @return false if the queue was closed before value could be pushed
+   */
+  auto push_wait(const T &value) -> bool {
+    push_waiters_.fetch_add(1);
+    bool pushed;
+    while (true) {
+      uint32_t seen = pops_.load();
+      if ((pushed = push(value)) || closed_.load()) {
+        break;
       }
-      next_head = (current_head + 1) % capacity;
+      pops_.wait(seen);
     }
-    value = buffer_[current_head];
-    return true;
+    push_waiters_.fetch_sub(1);
+    return pushed;
   }
 
   /**
-   * Helper functions for writing data back to disk.
+   * Pop, sleeping while the queue is empty.
+   * @return false if the queue is closed and empty
    */
-  auto get_head() -> int { return head_.load(); }
+  auto pop_wait(T &value) -> bool { return pop_bulk_wait(&value, 1) == 1; }
+
+  /**
+   * Pop up to count values, sleeping while the queue is empty.
+   * @return number of values popped, 0 if the queue is closed and empty
+   */
+  auto pop_bulk_wait(T *values, size_t count) -> size_t {
+    pop_waiters_.fetch_add(1);
+    size_t n;
+    while (true) {
+      uint32_t seen = pushes_.load();
+      if ((n = pop_bulk(values, count)) > 0 || closed_.load()) {
+        break;
+      }
+      pushes_.wait(seen);
+    }
+    pop_waiters_.fetch_sub(1);
+    return n;
+  }
 
-  auto get_tail() -> int { return tail_.load(); }
+  /** Wake up every waiter for good. Non-blocking push() and pop() keep working. */
+  void close() {
+    closed_.store(true);
+    pushes_.fetch_add(1);
+    pops_.fetch_add(1);
+    pushes_.notify_all();
+    pops_.notify_all();
+  }
+
+  /** @return a snapshot of the number of values in the queue, exact only when no push or pop is in flight */
+  auto size() const -> size_t {
+    intptr_t n = Diff(tail_.load(std::memory_order_relaxed), head_.load(std::memory_order_relaxed));
+    return n < 0 ? 0 : static_cast<size_t>(n);
+  }
 
-  auto get_value(int index) -> const T & { return buffer_[index]; };
+  auto empty() const -> bool { return size() == 0; }
 };
 }  // namespace CrazyDave
-#endif  // BPT_PRO_CONCURRENT_LIST_H
\ No newline at end of file
+#endif  // BPT_PRO_CONCURRENT_LIST_H
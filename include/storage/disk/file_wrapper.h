@@ -1,8 +1,13 @@
 #ifndef BPT_PRO_FILE_WRAPPER_H
 #define BPT_PRO_FILE_WRAPPER_H
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
 #include <cstring>
 #include <fstream>
 #include <string>
+#include "common/config.h"
 
 /**
  * A helper class for implementing i/o manipulation.
@@ -54,5 +59,121 @@ class MyFile {
 
   auto IsNew() const -> bool { return is_new_; }
 };
+
+/**
+ * A helper class for positional page i/o on a raw file descriptor.
+ * In direct mode the file is opened with O_DIRECT so that the kernel page cache is bypassed, in which case every
+ * buffer, size and offset passed in must be aligned to FRAME_ALIGNMENT. Falls back to buffered i/o if the file
+ * system does not support O_DIRECT.
+ */
+class MyDirectFile {
+  int fd_{-1};
+  bool is_new_{false};
+  bool is_direct_{false};
+
+ public:
+  explicit MyDirectFile(const std::string &name, bool direct_io = false) {
+    is_new_ = access(name.c_str(), F_OK) != 0;
+    if (direct_io) {
+      fd_ = open(name.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+      is_direct_ = fd_ != -1;
+    }
+    if (fd_ == -1) {
+      fd_ = open(name.c_str(), O_RDWR | O_CREAT, 0644);
+    }
+  }
+
+  ~MyDirectFile() {
+    if (fd_ != -1) {
+      close(fd_);
+    }
+  }
+
+  /**
+   * Read size bytes at offset, retrying after interruptions and short reads. Bytes beyond the end of file are zeroed.
+   * @return false if the read failed, e.g. with EIO or with EINVAL for a misaligned direct read; data is undefined
+   */
+  auto ReadAt(char *data, size_t size, off_t offset) -> bool {
+    size_t done = 0;
+    while (done < size) {
+      auto n = pread(fd_, data + done, size - done, offset + static_cast<off_t>(done));
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        return false;
+      }
+      if (n == 0) {
+        break;
+      }
+      done += n;
+    }
+    if (done < size) {
+      memset(data + done, 0, size - done);
+    }
+    return true;
+  }
+
+  /**
+   * Write size bytes at offset, retrying after interruptions and short writes.
+   * @return false if the write failed, e.g. with EIO or ENOSPC; the bytes at offset are then undefined
+   */
+  auto WriteAt(const char *data, size_t size, off_t offset) -> bool {
+    size_t done = 0;
+    while (done < size) {
+      auto n = pwrite(fd_, data + done, size - done, offset + static_cast<off_t>(done));
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0 || Written(n) == 0) {
+        return false;
+      }
+      done += Written(n);
+    }
+    return true;
+  }
+
+  /**
+   * Write the buffers of iov back to back at offset with as few pwritev calls as it takes. Consumes iov.
+   * @return false if the write failed, see WriteAt()
+   */
+  auto WriteV(iovec *iov, int count, off_t offset) -> bool {
+    while (count > 0) {
+      auto n = pwritev(fd_, iov, count, offset);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0 || Written(n) == 0) {
+        return false;
+      }
+      n = static_cast<ssize_t>(Written(n));
+      offset += n;
+      for (; count > 0 && static_cast<size_t>(n) >= iov->iov_len; ++iov, --count) {
+        n -= static_cast<ssize_t>(iov->iov_len);
+      }
+      if (count > 0) {
+        iov->iov_base = static_cast<char *>(iov->iov_base) + n;
+        iov->iov_len -= n;
+      }
+    }
+    return true;
+  }
+
+  void Flush() { fdatasync(fd_); }
+
+  auto IsNew() const -> bool { return is_new_; }
+
+  auto IsDirect() const -> bool { return is_direct_; }
+
+ private:
+  /**
+   * @return how much of a write of n bytes counts as done. A short write under O_DIRECT is rounded down to
+   * FRAME_ALIGNMENT, so that the rest is written again from an aligned buffer and offset.
+   */
+  auto Written(ssize_t n) const -> size_t {
+    auto written = static_cast<size_t>(n);
+    return is_direct_ ? written - written % FRAME_ALIGNMENT : written;
+  }
+};
 }  // namespace CrazyDave
 #endif  // BPT_PRO_FILE_WRAPPER_H
@@ -4,14 +4,30 @@
 #include <fstream>
 #include <string>
 #include "common/config.h"
+#include "common/striped_counter.h"
+#include "data_structures/list.h"
+#include "data_structures/vector.h"
 #include "file_wrapper.h"
 namespace CrazyDave {
 
+/** Counters of a disk manager. */
+struct DiskStats {
+  size_t page_reads_{0};
+  size_t page_writes_{0};
+  size_t vectored_writes_{0};  // pwritev calls that wrote a run of several pages
+  size_t allocated_pages_{0};
+  size_t deallocated_pages_{0};
+};
+
 class MyDiskManager {
  public:
-  explicit MyDiskManager(const std::string &name) {
+  /**
+   * @param name prefix of the data and garbage files
+   * @param direct_io open the data file with O_DIRECT, page buffers must then be FRAME_ALIGNMENT aligned
+   */
+  explicit MyDiskManager(const std::string &name, bool direct_io = false) : name_(name) {
     garbage_file = new MyFile(name + "_gb");
-    data_file_ = new MyFile(name + "_dt");
+    data_file_ = new MyDirectFile(name + "_dt", direct_io);
     if (!garbage_file->IsNew()) {
       garbage_file->SetReadPointer(0);
       size_t size;
@@ -40,17 +56,49 @@ class MyDiskManager {
     delete garbage_file;
     delete data_file_;
   }
-  void WritePage(page_id_t page_id, const char *page_data) {
-    int offset = page_id * BUSTUB_PAGE_SIZE;
-    data_file_->SetWritePointer(offset);
-    data_file_->Write(page_data, BUSTUB_PAGE_SIZE);
+  /** @return false if the page could not be written */
+  auto WritePage(page_id_t page_id, const char *page_data) -> bool {
+    page_writes_.Add();
+    return data_file_->WriteAt(page_data, BUSTUB_PAGE_SIZE, static_cast<off_t>(page_id) * BUSTUB_PAGE_SIZE);
   }
-  void ReadPage(page_id_t page_id, char *page_data) {
-    int offset = page_id * BUSTUB_PAGE_SIZE;
-    data_file_->SetReadPointer(offset);
-    data_file_->Read(page_data, BUSTUB_PAGE_SIZE);
+  /**
+   * Write pages sorted by page id. Each run of consecutive ids, up to WRITE_RUN_PAGES long, goes out as one vectored
+   * write.
+   * @param page_ids ids of the pages, ascending
+   * @param pages data of the pages, in the same order
+   * @return false if any of the pages could not be written, the other runs are written all the same
+   */
+  auto WritePages(const page_id_t *page_ids, const char *const *pages, size_t count) -> bool {
+    bool written = true;
+    iovec iov[WRITE_RUN_PAGES];
+    for (size_t i = 0; i < count;) {
+      size_t run = 1;
+      while (i + run < count && run < WRITE_RUN_PAGES &&
+             page_ids[i + run] == page_ids[i] + static_cast<page_id_t>(run)) {
+        ++run;
+      }
+      auto offset = static_cast<off_t>(page_ids[i]) * BUSTUB_PAGE_SIZE;
+      page_writes_.Add(run);
+      if (run == 1) {
+        written &= data_file_->WriteAt(pages[i], BUSTUB_PAGE_SIZE, offset);
+      } else {
+        for (size_t j = 0; j < run; ++j) {
+          iov[j] = {const_cast<char *>(pages[i + j]), BUSTUB_PAGE_SIZE};
+        }
+        vectored_writes_.Add();
+        written &= data_file_->WriteV(iov, static_cast<int>(run), offset);
+      }
+      i += run;
+    }
+    return written;
+  }
+  /** @return false if the page could not be read, a page past the end of the file reads as zeros */
+  auto ReadPage(page_id_t page_id, char *page_data) -> bool {
+    page_reads_.Add();
+    return data_file_->ReadAt(page_data, BUSTUB_PAGE_SIZE, static_cast<off_t>(page_id) * BUSTUB_PAGE_SIZE);
   }
   auto AllocatePage() -> page_id_t {
+    allocated_pages_.Add();
     if (!queue_.empty()) {
       auto page_id = queue_.front();
       queue_.pop_front();
@@ -59,15 +107,64 @@ class MyDiskManager {
     return ++max_page_id_;
   }
 
-  void DeallocatePage(page_id_t page_id) { queue_.push_back(page_id); }
+  void DeallocatePage(page_id_t page_id) {
+    deallocated_pages_.Add();
+    queue_.push_back(page_id);
+  }
+  /** Persist the ids of the pages the buffer pool held, hottest first, for the next run to warm up with. */
+  void SaveHotPages(const vector<page_id_t> &page_ids) {
+    MyFile hot_file(name_ + "_hot");
+    hot_file.SetWritePointer(0);
+    size_t size = page_ids.size();
+    hot_file.WriteObj(size);
+    for (size_t i = 0; i < size; ++i) {
+      hot_file.WriteObj(page_ids[i]);
+    }
+  }
+  /**
+   * Read the hottest page ids saved by SaveHotPages(), nothing if they were never saved. A list cut short by a crash
+   * ends at the first id that could not be read. Ids past the last allocated page are skipped.
+   */
+  void LoadHotPages(vector<page_id_t> *page_ids, size_t max_count) {
+    MyFile hot_file(name_ + "_hot");
+    if (hot_file.IsNew()) {
+      return;
+    }
+    hot_file.SetReadPointer(0);
+    size_t size = 0;
+    hot_file.ReadObj(size);
+    for (size_t i = 0; i < size && i < max_count; ++i) {
+      page_id_t page_id = INVALID_PAGE_ID;
+      hot_file.ReadObj(page_id);
+      if (page_id < 0) {
+        break;
+      }
+      if (page_id > max_page_id_) {
+        continue;
+      }
+      page_ids->push_back(page_id);
+    }
+  }
   auto IsNew() -> bool { return garbage_file->IsNew(); }
+  auto IsDirect() -> bool { return data_file_->IsDirect(); }
+  auto GetStats() const -> DiskStats {
+    return {page_reads_.Load(), page_writes_.Load(), vectored_writes_.Load(), allocated_pages_.Load(),
+            deallocated_pages_.Load()};
+  }
 
  private:
-  MyFile *data_file_{nullptr};
+  std::string name_;
+  MyDirectFile *data_file_{nullptr};
   MyFile *garbage_file{nullptr};  // 第一位size_，第二位max_page_id_
 
   list<page_id_t> queue_{};
   page_id_t max_page_id_{0};
+
+  StripedCounter page_reads_;
+  StripedCounter page_writes_;
+  StripedCounter vectored_writes_;
+  StripedCounter allocated_pages_;
+  StripedCounter deallocated_pages_;
 };
 }  // namespace CrazyDave
 #endif  // BPT_PRO_DISK_MANAGER_H
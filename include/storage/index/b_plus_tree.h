@@ -1,11 +1,14 @@
 #pragma once
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
 #include <optional>
 #include <string>
 
 #include "common/config.h"
+#include "common/striped_counter.h"
 #include "common/utils.h"
-#include "data_structures/list.h"
+#include "data_structures/inline_deque.h"
 #include "data_structures/vector.h"
 #include "storage/index/index_iterator.h"
 #include "storage/page/b_plus_tree_header_page.h"
@@ -23,6 +26,10 @@ namespace CrazyDave {
  */
 class Context {
  public:
+  // The epoch of the operation, declared first so that it is left only after every page guard below is dropped.
+  // Pages unlinked by the operation are retired into it.
+  EpochGuard epoch_;
+
   // When you insert into / remove from the B+ tree, store the write guard of header page here.
   // Remember to drop the header page guard and set it to nullopt when you want to unlock all.
   std::optional<WritePageGuard> header_write_guard_{std::nullopt};
@@ -32,18 +39,44 @@ class Context {
   // Save the root page id here so that it's easier to know if the current page is the root page.
   page_id_t root_page_id_{INVALID_PAGE_ID};
 
-  // Store the write guards of the pages that you're modifying here.
-  list<WritePageGuard> write_set_;
+  // Store the write guards of the pages that you're modifying here. The path stacks live inline in the
+  // Context, so a tree operation does not allocate to track its path.
+  inline_deque<WritePageGuard, MAX_TREE_HEIGHT> write_set_;
+
+  // Pages allocated up front for the splits of an insertion, see BPlusTree::ReserveNewPages().
+  inline_deque<BasicPageGuard, MAX_TREE_HEIGHT + 1> new_pages_;
 
   // You may want to use this when getting value, but not necessary.
-  list<ReadPageGuard> read_set_;
+  inline_deque<ReadPageGuard, MAX_TREE_HEIGHT> read_set_;
 
   // Record the index of key in the path.
-  list<int> index_set_;
+  inline_deque<int, MAX_TREE_HEIGHT> index_set_;
 
   [[nodiscard]] auto IsRootPage(page_id_t page_id) const -> bool { return page_id == root_page_id_; }
 };
 
+/** Operation counts of a B+ tree and the page fetches of each kind of operation, see BPlusTree::GetStats(). */
+struct BPlusTreeStats {
+  size_t finds_{0};
+  size_t inserts_{0};
+  size_t removes_{0};
+  size_t find_fetches_{0};
+  size_t insert_fetches_{0};
+  size_t remove_fetches_{0};
+  BufferPoolStats pool_;
+
+  /** @brief Print the counters as text, one per line. */
+  void Dump(std::ostream &os) const {
+    auto per_op = [](size_t fetches, size_t ops) {
+      return ops == 0 ? 0 : static_cast<double>(fetches) / static_cast<double>(ops);
+    };
+    os << "tree: " << finds_ << " finds, " << inserts_ << " inserts, " << removes_ << " removes\n"
+       << "  page fetches per find " << per_op(find_fetches_, finds_) << ", per insert "
+       << per_op(insert_fetches_, inserts_) << ", per remove " << per_op(remove_fetches_, removes_) << "\n";
+    pool_.Dump(os);
+  }
+};
+
 #define BPLUSTREE_TYPE BPlusTree<KeyType, ValueType, KeyComparator>
 
 // Main class providing the API for the Interactive B+ Tree.
@@ -56,7 +89,8 @@ class BPlusTree {
 
  public:
   explicit BPlusTree(std::string name, page_id_t header_page_id, size_t pool_size, size_t replacer_k,
-                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE)
+                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE,
+                     ReplacerType replacer_type = ReplacerType::LRUK)
       : index_name_(std::move(name)),
         leaf_max_size_(leaf_max_size),
         internal_max_size_(internal_max_size),
@@ -64,92 +98,389 @@ class BPlusTree {
     //  std::cout << "Hello from asshole debugger CrazyDave.\nConstructing BPlusTree.\nleaf_max_size: " <<
     //  leaf_max_size_
     //            << ", internal_max_size: " << internal_max_size_ << "\n";  // debug
-    bpm_ = new BufferPoolManager{index_name_, pool_size, replacer_k};
-    if (bpm_->IsNew()) {
-      WritePageGuard guard = bpm_->FetchPageWrite(header_page_id_);
-      auto root_page = guard.AsMut<BPlusTreeHeaderPage>();
-      root_page->root_page_id_ = INVALID_PAGE_ID;
+    bpm_ = new BufferPoolManager{index_name_, pool_size, replacer_k, false, replacer_type};
+    owns_bpm_ = true;
+    Init();
+  }
+
+  /**
+   * @brief Open a tree in a buffer pool shared with other trees, as one of the files of the pool.
+   *
+   * The trees then compete for the same frames, so memory goes to whichever of them is hot, and a quota may be put
+   * on the tree with BufferPoolManager::SetFileQuota(GetFileId(), frames). The pool must outlive the tree and must
+   * have a file slot left, see BufferPoolManager::OpenFile(); the program is aborted with an error message otherwise.
+   */
+  explicit BPlusTree(std::string name, page_id_t header_page_id, BufferPoolManager *bpm,
+                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE)
+      : index_name_(std::move(name)),
+        bpm_(bpm),
+        leaf_max_size_(leaf_max_size),
+        internal_max_size_(internal_max_size),
+        header_page_id_(header_page_id) {
+    file_id_ = bpm_->OpenFile(index_name_);
+    if (file_id_ == INVALID_FILE_ID) {
+      std::cerr << "cannot open " << index_name_ << ": buffer pool already serves " << MAX_FILES << " files\n";
+      std::abort();
     }
+    Init();
   }
-  ~BPlusTree() { delete bpm_; }
 
-  // Returns true if this B+ tree has no keys and values.
+  ~BPlusTree() {
+    ReleaseResidents();
+    if (owns_bpm_) {
+      delete bpm_;
+    }
+  }
+
+  /** @return the id of the file of the tree in its buffer pool */
+  auto GetFileId() const -> file_id_t { return file_id_; }
+
+  /**
+   * @brief Keep the header page and the top levels of the tree resident in the buffer pool.
+   *
+   * Pages in the top levels are pinned for good the first time a traversal reaches them and are then reached
+   * through cached frame pointers, skipping the page table, the replacer and pin bookkeeping. The cache is
+   * direct-mapped by page id and holds at most min(RESIDENT_CACHE_SIZE, pool_size / 4) pages, a page whose slot is
+   * taken is fetched the usual way. The cache is emptied whenever the root changes, since the levels of every page
+   * shift then. Operations may run concurrently, but not with this call.
+   *
+   * @param levels number of levels below the header kept resident, 1 for the root only, 0 disables the feature
+   */
+  void SetResidentLevels(int levels) {
+    ReleaseResidents();
+    resident_levels_ = levels;
+    if (resident_levels_ > 0) {
+      header_frame_ = bpm_->PinResident(header_page_id_, file_id_);
+    }
+  }
+
+  /**
+   * @brief Turn pointer swizzling of child references below the resident levels on or off, it is off by default.
+   * See BufferPoolManager::EnableSwizzling().
+   */
+  void EnablePointerSwizzling(bool enable) { bpm_->EnableSwizzling(enable); }
+
+  /**
+   * @brief Log the page accesses of the buffer pool of the tree to a trace file, see BufferPoolManager::StartTrace().
+   * The trace covers every file of a shared pool, and is closed with the pool or by StopTrace().
+   */
+  auto StartTrace(const std::string &path) -> bool { return bpm_->StartTrace(path); }
+
+  void StopTrace() { bpm_->StopTrace(); }
+
+  /**
+   * @brief Grow or shrink the buffer pool of the tree, see BufferPoolManager::Resize().
+   *
+   * The resident pages are released first, since shrinking could not give back the frames they pin, and the cache is
+   * resized to the new pool and filled again by the next traversals. No operation on the tree may run meanwhile.
+   */
+  auto ResizeBufferPool(size_t pool_size) -> bool {
+    ReleaseResidents();
+    bool resized = bpm_->Resize(pool_size);
+    SizeResidentCache();
+    SetResidentLevels(resident_levels_);
+    return resized;
+  }
+
+  // Returns true if this B+ tree has no keys and values, or if its header page could not be fetched.
   [[nodiscard]] auto IsEmpty() const -> bool {
-    auto guard = bpm_->FetchPageRead(header_page_id_);
+    auto guard = bpm_->FetchPageRead(header_page_id_, AccessType::Index, file_id_);
+    if (!guard.IsValid()) {
+      return true;
+    }
     auto root_page = guard.As<BPlusTreeHeaderPage>();
     return root_page->root_page_id_ == INVALID_PAGE_ID;
   }
 
-  void insert(const KeyFirst &key, const KeySecond &value) { insert({key, value}, {}); }
+  /**
+   * @return false if a page the insertion needed could not be fetched or allocated, the buffer pool having no frame
+   * to give (see BufferPoolManager::FetchPage()); the tree is then left as it was. Inserting a pair already in the
+   * tree succeeds without changing it.
+   */
+  auto insert(const KeyFirst &key, const KeySecond &value) -> bool {
+    auto fetches = BufferPoolManager::GetThreadFetchCount();
+    bool inserted = insert({key, value}, {});
+    inserts_.Add();
+    insert_fetches_.Add(BufferPoolManager::GetThreadFetchCount() - fetches);
+    return inserted;
+  }
 
-  void remove(const KeyFirst &key, const KeySecond &value) { remove({key, value}); }
+  /**
+   * @return false if a page on the path to the pair could not be fetched, the pair is then still in the tree. A page
+   * whose neighbour cannot be fetched is left underfull, which searches do not mind.
+   */
+  auto remove(const KeyFirst &key, const KeySecond &value) -> bool {
+    auto fetches = BufferPoolManager::GetThreadFetchCount();
+    bool removed = remove({key, value});
+    removes_.Add();
+    remove_fetches_.Add(BufferPoolManager::GetThreadFetchCount() - fetches);
+    return removed;
+  }
 
-  // Return the value associated with a given key
-  void find(const KeyFirst &key, vector<KeySecond> &result) {
-    auto header_page_guard = bpm_->FetchPageRead(header_page_id_);
+  /**
+   * Append the values associated with a given key to result.
+   * @return false if a page could not be fetched, result then misses the values under it
+   */
+  template <size_t InlineN>
+  auto find(const KeyFirst &key, vector<KeySecond, InlineN> &result) -> bool {
+    auto fetches = BufferPoolManager::GetThreadFetchCount();
+    finds_.Add();
+    EpochGuard epoch = bpm_->EnterEpoch();
+    ReadPageGuard header_page_guard = FetchHeaderRead();
+    if (!header_page_guard.IsValid()) {
+      return false;
+    }
     auto header_page = header_page_guard.As<BPlusTreeHeaderPage>();
     if (header_page->root_page_id_ == INVALID_PAGE_ID) {
       header_page_guard.Drop();
-      return;
+      find_fetches_.Add(BufferPoolManager::GetThreadFetchCount() - fetches);
+      return true;
     }
-    auto guard = bpm_->FetchPageRead(header_page->root_page_id_);
+    ReadPageGuard guard = FetchRead(header_page->root_page_id_, 0, AccessType::Index);
     header_page_guard.Drop();
-    find({key, {}}, result, guard);
+    bool fetched = guard.IsValid() && find({key, {}}, result, guard, 0);
+    find_fetches_.Add(BufferPoolManager::GetThreadFetchCount() - fetches);
+    return fetched;
+  }
+
+  /**
+   * @brief Take a snapshot of the operation counters of the tree and of its buffer pool. Page fetches count the
+   * pages read through the buffer pool; pages of the resident levels are read without it and are not counted.
+   */
+  auto GetStats() -> BPlusTreeStats {
+    BPlusTreeStats stats;
+    stats.finds_ = finds_.Load();
+    stats.inserts_ = inserts_.Load();
+    stats.removes_ = removes_.Load();
+    stats.find_fetches_ = find_fetches_.Load();
+    stats.insert_fetches_ = insert_fetches_.Load();
+    stats.remove_fetches_ = remove_fetches_.Load();
+    stats.pool_ = bpm_->GetStats();
+    return stats;
   }
 
-  // Return the page id of the root node
+  // Return the page id of the root node, INVALID_PAGE_ID if the header page could not be fetched
   auto GetRootPageId() -> page_id_t {
-    auto guard = bpm_->FetchPageRead(header_page_id_);
+    ReadPageGuard guard = FetchHeaderRead();
+    if (!guard.IsValid()) {
+      return INVALID_PAGE_ID;
+    }
     auto header_page = guard.As<BPlusTreeHeaderPage>();
     return header_page->root_page_id_;
   }
 
-  // Index iterator
+  // Index iterator, End() as well if a page on the way could not be fetched
   auto Begin() -> INDEXITERATOR_TYPE {
-    auto header_page = bpm_->FetchPageRead(header_page_id_).As<BPlusTreeHeaderPage>();
+    EpochGuard epoch = bpm_->EnterEpoch();
+    ReadPageGuard header_guard = FetchHeaderRead();
+    if (!header_guard.IsValid()) {
+      return End();
+    }
+    auto header_page = header_guard.As<BPlusTreeHeaderPage>();
     if (header_page->root_page_id_ == INVALID_PAGE_ID) {
       return End();
     }
 
-    auto guard = bpm_->FetchPageRead(header_page->root_page_id_);
+    ReadPageGuard guard = FetchRead(header_page->root_page_id_, 0, AccessType::Index);
+    if (!guard.IsValid()) {
+      return End();
+    }
     auto bpt_page = guard.As<BPlusTreePage>();
     page_id_t page_id = header_page->root_page_id_;
+    header_guard.Drop();
+    int depth = 0;
     while (!bpt_page->IsLeafPage()) {
       auto internal_page = reinterpret_cast<const InternalPage *>(bpt_page);
-      page_id = internal_page->ValueAt(0);
-      guard = bpm_->FetchPageRead(page_id);
+      guard = FetchChildRead(internal_page->ValueRefAt(0), ++depth, AccessType::Index);
+      if (!guard.IsValid()) {
+        return End();
+      }
       bpt_page = guard.As<BPlusTreePage>();
     }
-    return {bpm_, page_id};
+    page_id = guard.PageId();
+    return {bpm_, file_id_, page_id};
   }
 
-  auto End() -> INDEXITERATOR_TYPE { return {bpm_, INVALID_PAGE_ID}; }
+  auto End() -> INDEXITERATOR_TYPE { return {bpm_, file_id_, INVALID_PAGE_ID}; }
 
   auto Begin(const KeyType &key) -> INDEXITERATOR_TYPE {
-    auto header_page = bpm_->FetchPageRead(header_page_id_).As<BPlusTreeHeaderPage>();
+    EpochGuard epoch = bpm_->EnterEpoch();
+    ReadPageGuard header_guard = FetchHeaderRead();
+    if (!header_guard.IsValid()) {
+      return End();
+    }
+    auto header_page = header_guard.As<BPlusTreeHeaderPage>();
     if (header_page->root_page_id_ == INVALID_PAGE_ID) {
       return End();
     }
 
-    auto guard = bpm_->FetchPageRead(header_page->root_page_id_);
+    ReadPageGuard guard = FetchRead(header_page->root_page_id_, 0, AccessType::Index);
+    if (!guard.IsValid()) {
+      return End();
+    }
     auto bpt_page = guard.As<BPlusTreePage>();
     page_id_t page_id = header_page->root_page_id_;
+    header_guard.Drop();
+    int depth = 0;
     while (!bpt_page->IsLeafPage()) {
       auto internal_page = reinterpret_cast<const InternalPage *>(bpt_page);
       auto l = UpperBound(internal_page, key) - 1;
-      page_id = internal_page->ValueAt(l);
-      guard = bpm_->FetchPageRead(page_id);
+      guard = FetchChildRead(internal_page->ValueRefAt(l), ++depth, AccessType::Index);
+      if (!guard.IsValid()) {
+        return End();
+      }
       bpt_page = guard.As<BPlusTreePage>();
     }
+    page_id = guard.PageId();
     auto leaf_page = reinterpret_cast<const LeafPage *>(bpt_page);
     auto l = BinarySearch(leaf_page, key);
     if (l != -1) {
-      return {bpm_, page_id, l};
+      return {bpm_, file_id_, page_id, l};
     }
     return End();
   }
 
  private:
+  /** Set up a new file and the resident cache, once the tree has its buffer pool and file. */
+  void Init() {
+    if (bpm_->IsNew(file_id_)) {
+      WritePageGuard guard = bpm_->FetchPageWrite(header_page_id_, AccessType::Index, file_id_);
+      auto root_page = guard.AsMut<BPlusTreeHeaderPage>();
+      root_page->root_page_id_ = INVALID_PAGE_ID;
+    }
+    SizeResidentCache();
+    SetResidentLevels(RESIDENT_LEVELS);
+  }
+
+  /** Fit the resident cache to a quarter of the buffer pool. Must be called with the cache empty. */
+  void SizeResidentCache() {
+    resident_capacity_ = RESIDENT_CACHE_SIZE;
+    while (resident_capacity_ > 0 && resident_capacity_ > bpm_->GetPoolSize() / 4) {
+      resident_capacity_ >>= 1;
+    }
+  }
+
+  /**
+   * @return the resident frame of page_id, pinning it first if its slot is free, nullptr if the slot is taken by
+   * another page or the page cannot be fetched
+   *
+   * The page id of a taken slot is read from its frame, which cannot change page while the slot pins it. A taken slot
+   * is left to its page: other threads may be using the frame without a pin of their own, so pages pushing each other
+   * out would only pile up pins retired until they are done. A thread losing the race to fill a free slot gives its
+   * own pin back at once, nobody else having seen it.
+   */
+  auto GetResident(page_id_t page_id) -> Page * {
+    auto &slot = resident_[page_id & (resident_capacity_ - 1)];
+    auto *resident = slot.load(std::memory_order_acquire);
+    if (resident != nullptr) {
+      return resident->GetPageId() == page_id ? resident : nullptr;
+    }
+    auto *page = bpm_->PinResident(page_id, file_id_);
+    if (page == nullptr) {
+      return nullptr;
+    }
+    if (!slot.compare_exchange_strong(resident, page, std::memory_order_acq_rel)) {
+      bpm_->ReleaseResident(page);
+      return resident->GetPageId() == page_id ? resident : nullptr;
+    }
+    return page;
+  }
+
+  /**
+   * Empty the resident cache after the root changed. Every page has moved one level down or up, so the cached ones
+   * need not be the top levels any more; the next traversals fill the cache again. The pins are retired in the epoch,
+   * other operations may still be reading the frames.
+   */
+  void RetireResidents(Context &ctx) {
+    for (size_t i = 0; i < resident_capacity_; ++i) {
+      if (auto *page = resident_[i].exchange(nullptr, std::memory_order_acq_rel); page != nullptr) {
+        ctx.epoch_.RetirePin(page);
+      }
+    }
+  }
+
+  /** Release every resident page right away, while no operation runs on the tree. */
+  void ReleaseResidents() {
+    for (size_t i = 0; i < resident_capacity_; ++i) {
+      if (auto *page = resident_[i].exchange(nullptr); page != nullptr) {
+        bpm_->ReleaseResident(page);
+      }
+    }
+    if (header_frame_ != nullptr) {
+      bpm_->ReleaseResident(header_frame_);
+      header_frame_ = nullptr;
+    }
+  }
+
+  auto FetchHeaderRead() -> ReadPageGuard {
+    if (header_frame_ != nullptr) {
+      return {bpm_, header_frame_, true};
+    }
+    return bpm_->FetchPageRead(header_page_id_, AccessType::Index, file_id_);
+  }
+
+  auto FetchHeaderWrite() -> WritePageGuard {
+    if (header_frame_ != nullptr) {
+      return {bpm_, header_frame_, true};
+    }
+    return bpm_->FetchPageWrite(header_page_id_, AccessType::Index, file_id_);
+  }
+
+  /** Fetch a tree page depth levels below the root, through the resident cache for the top levels. */
+  auto FetchRead(page_id_t page_id, int depth, AccessType access_type) -> ReadPageGuard {
+    if (depth < resident_levels_ && resident_capacity_ > 0) {
+      if (auto *page = GetResident(page_id); page != nullptr) {
+        return {bpm_, page, true};
+      }
+    }
+    return bpm_->FetchPageRead(page_id, access_type, file_id_);
+  }
+
+  auto FetchWrite(page_id_t page_id, int depth, AccessType access_type) -> WritePageGuard {
+    if (depth < resident_levels_ && resident_capacity_ > 0) {
+      if (auto *page = GetResident(page_id); page != nullptr) {
+        return {bpm_, page, true};
+      }
+    }
+    return bpm_->FetchPageWrite(page_id, access_type, file_id_);
+  }
+
+  /**
+   * Fetch the child a reference in a pinned internal page points to. Resident levels take a plain page id, below
+   * them the reference goes through BufferPoolManager::FetchChild() and may be swizzled.
+   */
+  auto FetchChildRead(const page_id_t *ref, int depth, AccessType access_type) -> ReadPageGuard {
+    auto page_id = BufferPoolManager::LoadRef(ref);
+    if (depth < resident_levels_ && !BufferPoolManager::IsSwizzled(page_id)) {
+      return FetchRead(page_id, depth, access_type);
+    }
+    return bpm_->FetchChildRead(ref, access_type);
+  }
+
+  auto FetchChildWrite(const page_id_t *ref, int depth, AccessType access_type) -> WritePageGuard {
+    auto page_id = BufferPoolManager::LoadRef(ref);
+    if (depth < resident_levels_ && !BufferPoolManager::IsSwizzled(page_id)) {
+      return FetchWrite(page_id, depth, access_type);
+    }
+    return bpm_->FetchChildWrite(ref, access_type);
+  }
+
+  /**
+   * Retire a page unlinked from the tree, dropping it from the resident cache first; its resident pin is retired too,
+   * other operations may still be reading the frame. It is deleted once the operations that might still reach it are
+   * done and its guards, possibly still held by ctx, are dropped.
+   */
+  void RetirePage(page_id_t page_id, Context &ctx) {
+    if (resident_capacity_ > 0) {
+      auto &slot = resident_[page_id & (resident_capacity_ - 1)];
+      auto *page = slot.load(std::memory_order_acquire);
+      if (page != nullptr && page->GetPageId() == page_id && slot.compare_exchange_strong(page, nullptr)) {
+        ctx.epoch_.RetirePin(page);
+      }
+    }
+    ctx.epoch_.Retire(page_id, file_id_);
+  }
+
   auto LowerBound(const LeafPage *page, const KeyType &key) const -> int {
     int l = 0;
     int r = page->GetSize();
@@ -233,8 +564,62 @@ class BPlusTree {
     return false;
   }
 
+  /**
+   * Allocate the pages the splits of an insertion are going to take before anything is changed, so that a buffer
+   * pool out of frames fails the insertion as a whole.
+   * @return false if not all of them could be allocated, those that were are retired again
+   */
+  auto ReserveNewPages(int count, Context &ctx) -> bool {
+    for (int i = 0; i < count; ++i) {
+      page_id_t page_id;
+      auto guard = bpm_->NewPageGuarded(&page_id, file_id_);
+      if (!guard.IsValid()) {
+        for (auto &page : ctx.new_pages_) {
+          ctx.epoch_.Retire(page.PageId(), file_id_);
+        }
+        ctx.new_pages_.clear();
+        return false;
+      }
+      ctx.new_pages_.push_back(std::move(guard));
+    }
+    return true;
+  }
+
+  /**
+   * @return the number of pages inserting one more pair into the leaf at the back of ctx.write_set_ allocates: one
+   * for each page that splits, plus a new root if the root splits
+   */
+  auto CountNewPages(const Context &ctx) const -> int {
+    auto *leaf_page = ctx.write_set_.back().template As<BPlusTreePage>();
+    if (leaf_page->GetSize() + 1 < leaf_page->GetMaxSize()) {
+      return 0;
+    }
+    int count = 1;
+    size_t i = ctx.write_set_.size() - 1;
+    // Every page above the leaf is full but maybe the topmost, a page still safe to insert into.
+    for (; i > 0; --i) {
+      auto *parent_page = ctx.write_set_[i - 1].template As<BPlusTreePage>();
+      if (parent_page->GetSize() + 1 <= parent_page->GetMaxSize()) {
+        break;
+      }
+      ++count;
+    }
+    if (i == 0 && ctx.IsRootPage(ctx.write_set_.front().PageId())) {
+      ++count;
+    }
+    return count;
+  }
+
+  /** Take a page allocated by ReserveNewPages(). */
+  auto TakeNewPage(page_id_t *page_id, Context &ctx) -> BasicPageGuard {
+    auto guard = std::move(ctx.new_pages_.front());
+    ctx.new_pages_.pop_front();
+    *page_id = guard.PageId();
+    return guard;
+  }
+
   auto SplitLeafPage(LeafPage *page, page_id_t *n_page_id, Context &ctx) -> LeafPage * {
-    auto n_page_guard = bpm_->NewPageGuarded(n_page_id);
+    BasicPageGuard n_page_guard = TakeNewPage(n_page_id, ctx);
     auto *n_page = n_page_guard.AsMut<LeafPage>();
 
     n_page->Init(leaf_max_size_);
@@ -247,12 +632,13 @@ class BPlusTree {
     page->SetNextPageId(*n_page_id);
     if (ctx.IsRootPage(ctx.write_set_.back().PageId())) {  // 根是叶子，新根
       page_id_t n_root_page_id;
-      auto n_root_guard = bpm_->NewPageGuarded(&n_root_page_id);
+      BasicPageGuard n_root_guard = TakeNewPage(&n_root_page_id, ctx);
       auto *n_root_page = n_root_guard.AsMut<InternalPage>();
       n_root_page->Init(internal_max_size_);
       if (ctx.header_write_guard_.has_value()) {
         ctx.header_write_guard_->AsMut<BPlusTreeHeaderPage>()->root_page_id_ = n_root_page_id;
       }
+      RetireResidents(ctx);
       n_root_page->InsertAt(0, KeyType(), ctx.root_page_id_);
       InsertKeyValue(n_root_page, n_page->KeyAt(0), *n_page_id);
       ctx.write_set_.pop_back();
@@ -260,6 +646,7 @@ class BPlusTree {
     }
     ctx.write_set_.pop_back();
     auto *p_page = ctx.write_set_.back().template AsMut<InternalPage>();
+    bpm_->Unswizzle(p_page);
 
     InsertKeyValue(p_page, n_page->KeyAt(0), *n_page_id);
 
@@ -272,9 +659,10 @@ class BPlusTree {
   }
 
   auto SplitInternalPage(InternalPage *page, page_id_t *n_page_id, Context &ctx) -> InternalPage * {
-    auto n_page_guard = bpm_->NewPageGuarded(n_page_id);
+    BasicPageGuard n_page_guard = TakeNewPage(n_page_id, ctx);
     auto *n_page = n_page_guard.AsMut<InternalPage>();
     n_page->Init(internal_max_size_);
+    bpm_->Unswizzle(page);
     auto size = page->GetSize();
     for (int i = size >> 1; i < size; ++i) {
       n_page->InsertAt(n_page->GetSize(), page->PairAt(i));
@@ -282,12 +670,13 @@ class BPlusTree {
     page->SetSize(size >> 1);
     if (ctx.IsRootPage(ctx.write_set_.back().PageId())) {  // 新根
       page_id_t n_root_page_id;
-      auto n_root_guard = bpm_->NewPageGuarded(&n_root_page_id);
+      BasicPageGuard n_root_guard = TakeNewPage(&n_root_page_id, ctx);
       auto *n_root_page = n_root_guard.AsMut<InternalPage>();
       n_root_page->Init(internal_max_size_);
       if (ctx.header_write_guard_.has_value()) {
         ctx.header_write_guard_->AsMut<BPlusTreeHeaderPage>()->root_page_id_ = n_root_page_id;
       }
+      RetireResidents(ctx);
       n_root_page->InsertAt(0, KeyType(), ctx.root_page_id_);
       InsertKeyValue(n_root_page, n_page->KeyAt(0), *n_page_id);
       ctx.write_set_.pop_back();
@@ -295,6 +684,7 @@ class BPlusTree {
     }
     ctx.write_set_.pop_back();
     auto *p_page = ctx.write_set_.back().template AsMut<InternalPage>();
+    bpm_->Unswizzle(p_page);
     InsertKeyValue(p_page, n_page->KeyAt(0), *n_page_id);
     return n_page;
   }
@@ -306,6 +696,11 @@ class BPlusTree {
     }
   }
 
+  /**
+   * Rebalance an underfull page by moving over a pair of a neighbour that can spare one.
+   * @return true if no merge is needed: a pair was moved, or a neighbour could not be fetched and the page stays
+   * underfull
+   */
   auto TryAdoptFromNeighbor(LeafPage *page, Context &ctx) -> bool {
     //  std::cout << "Trying to adopt a child from neighbor. Type: leaf_page\n Before: " << page->ToString()
     //            << "\n";  // debug
@@ -313,10 +708,14 @@ class BPlusTree {
     auto it = ctx.write_set_.end();
     --it, --it;
     auto *p_page = it->AsMut<InternalPage>();
+    bpm_->Unswizzle(p_page);
     int l = ctx.index_set_.back();
     if (l < p_page->GetSize() - 1) {
       auto r_page_id = p_page->ValueAt(l + 1);
-      auto r_page_guard = bpm_->FetchPageWrite(r_page_id);
+      auto r_page_guard = bpm_->FetchPageWrite(r_page_id, AccessType::Unknown, file_id_);
+      if (!r_page_guard.IsValid()) {
+        return true;
+      }
       auto *r_page = r_page_guard.template AsMut<LeafPage>();
       if (r_page->GetSize() > r_page->GetMinSize()) {
         page->InsertAt(page->GetSize(), r_page->PairAt(0));
@@ -331,7 +730,10 @@ class BPlusTree {
     }
     if (l > 0) {
       auto l_page_id = p_page->ValueAt(l - 1);
-      auto l_page_guard = bpm_->FetchPageWrite(l_page_id);
+      auto l_page_guard = bpm_->FetchPageWrite(l_page_id, AccessType::Unknown, file_id_);
+      if (!l_page_guard.IsValid()) {
+        return true;
+      }
       auto *l_page = l_page_guard.template AsMut<LeafPage>();
       if (l_page->GetSize() > l_page->GetMinSize()) {
         page->InsertAt(0, l_page->PairAt(l_page->GetSize() - 1));
@@ -348,17 +750,22 @@ class BPlusTree {
     return false;
   }
 
-  void MergeLeafPage(LeafPage *page, Context &ctx) {
+  /** Merge an underfull page with a neighbour. @return false if the neighbour could not be fetched */
+  auto MergeLeafPage(LeafPage *page, Context &ctx) -> bool {
     // 必须先 TryAdoptFromNeighbor，再考虑 MergeLeafPage。领养失败则必定能合并
     //  std::cout << "Merging a page. Type: leaf_page.\n Before: " << page->ToString() << "\n";  // debug
     //  auto *p_page = ctx.write_set_[ctx.write_set_.size() - 2].AsMut<InternalPage>();
     auto it = ctx.write_set_.end();
     --it, --it;
     auto *p_page = it->AsMut<InternalPage>();
+    bpm_->Unswizzle(p_page);
     int l = ctx.index_set_.back();
     if (l < p_page->GetSize() - 1) {
       auto r_page_id = p_page->ValueAt(l + 1);
-      auto r_page_guard = bpm_->FetchPageWrite(r_page_id);
+      auto r_page_guard = bpm_->FetchPageWrite(r_page_id, AccessType::Unknown, file_id_);
+      if (!r_page_guard.IsValid()) {
+        return false;
+      }
       auto *r_page = r_page_guard.template AsMut<LeafPage>();
       //    std::cout << "Merging r_page: " << r_page->ToString() << " to page: " << page->ToString() << "\n";  // debug
       for (int i = 0; i < r_page->GetSize(); ++i) {
@@ -367,14 +774,17 @@ class BPlusTree {
       r_page->SetSize(0);
       page->SetNextPageId(r_page->GetNextPageId());
       p_page->RemoveAt(l + 1);
-      bpm_->DeletePage(r_page_id);
+      RetirePage(r_page_id, ctx);
       ctx.write_set_.pop_back();
       ctx.index_set_.pop_back();
       //    std::cout << "Successfully merged. After merging, page: " << page->ToString() << "\n";  // debug
-      return;
+      return true;
     }
     auto l_page_id = p_page->ValueAt(l - 1);
-    auto l_page_guard = bpm_->FetchPageWrite(l_page_id);
+    auto l_page_guard = bpm_->FetchPageWrite(l_page_id, AccessType::Unknown, file_id_);
+    if (!l_page_guard.IsValid()) {
+      return false;
+    }
     auto *l_page = l_page_guard.template AsMut<LeafPage>();
     //  std::cout << "Merging page: " << page->ToString() << " to l_page: " << l_page->ToString() << "\n";  // debug
     for (int i = 0; i < page->GetSize(); ++i) {
@@ -383,12 +793,14 @@ class BPlusTree {
     page->SetSize(0);
     l_page->SetNextPageId(page->GetNextPageId());
     p_page->RemoveAt(l);
-    bpm_->DeletePage(p_page->ValueAt(l));
+    RetirePage(p_page->ValueAt(l), ctx);
     ctx.write_set_.pop_back();
     ctx.index_set_.pop_back();
     //  std::cout << "Successfully merged. After merging, l_page: " << l_page->ToString() << "\n";  // debug
+    return true;
   }
 
+  /** See TryAdoptFromNeighbor(LeafPage *, Context &). */
   auto TryAdoptFromNeighbor(InternalPage *page, Context &ctx) -> bool {
     //  std::cout << "Trying to adopt a child from neighbor. Type: leaf_page\n Before: " << page->ToString()
     //            << "\n";  // debug
@@ -396,11 +808,17 @@ class BPlusTree {
     auto it = ctx.write_set_.end();
     --it, --it;
     auto *p_page = it->AsMut<InternalPage>();
+    bpm_->Unswizzle(p_page);
+    bpm_->Unswizzle(page);
     int l = ctx.index_set_.back();
     if (l < p_page->GetSize() - 1) {
       auto r_page_id = p_page->ValueAt(l + 1);
-      auto r_page_guard = bpm_->FetchPageWrite(r_page_id);
+      auto r_page_guard = bpm_->FetchPageWrite(r_page_id, AccessType::Unknown, file_id_);
+      if (!r_page_guard.IsValid()) {
+        return true;
+      }
       auto *r_page = r_page_guard.template AsMut<InternalPage>();
+      bpm_->Unswizzle(r_page);
       if (r_page->GetSize() > r_page->GetMinSize()) {
         page->InsertAt(page->GetSize(), r_page->PairAt(0));
         r_page->RemoveAt(0);
@@ -414,8 +832,12 @@ class BPlusTree {
     }
     if (l > 0) {
       auto l_page_id = p_page->ValueAt(l - 1);
-      auto l_page_guard = bpm_->FetchPageWrite(l_page_id);
+      auto l_page_guard = bpm_->FetchPageWrite(l_page_id, AccessType::Unknown, file_id_);
+      if (!l_page_guard.IsValid()) {
+        return true;
+      }
       auto *l_page = l_page_guard.template AsMut<InternalPage>();
+      bpm_->Unswizzle(l_page);
       if (l_page->GetSize() > l_page->GetMinSize()) {
         page->InsertAt(0, l_page->PairAt(l_page->GetSize() - 1));
         l_page->RemoveAt(l_page->GetSize() - 1);
@@ -431,65 +853,88 @@ class BPlusTree {
     return false;
   }
 
-  void MergeInternalPage(InternalPage *page, Context &ctx) {
+  /** See MergeLeafPage(). */
+  auto MergeInternalPage(InternalPage *page, Context &ctx) -> bool {
     // 必须先 TryAdoptFromNeighbor，再考虑 MergeLeafPage。领养失败则必定能合并
     //  std::cout << "Merging a page. Type: leaf_page.\n Before: " << page->ToString() << "\n";  // debug
     //  auto *p_page = ctx.write_set_[ctx.write_set_.size() - 2].AsMut<InternalPage>();
     auto it = ctx.write_set_.end();
     --it, --it;
     auto *p_page = it->AsMut<InternalPage>();
+    bpm_->Unswizzle(p_page);
+    bpm_->Unswizzle(page);
     int l = ctx.index_set_.back();
     if (l < p_page->GetSize() - 1) {
       auto r_page_id = p_page->ValueAt(l + 1);
-      auto r_page_guard = bpm_->FetchPageWrite(r_page_id);
+      auto r_page_guard = bpm_->FetchPageWrite(r_page_id, AccessType::Unknown, file_id_);
+      if (!r_page_guard.IsValid()) {
+        return false;
+      }
       auto *r_page = r_page_guard.template AsMut<InternalPage>();
+      bpm_->Unswizzle(r_page);
       //    std::cout << "Merging r_page: " << r_page->ToString() << " to page: " << page->ToString() << "\n";  // debug
       for (int i = 0; i < r_page->GetSize(); ++i) {
         page->InsertAt(page->GetSize(), r_page->PairAt(i));
       }
       r_page->SetSize(0);
       p_page->RemoveAt(l + 1);
-      bpm_->DeletePage(r_page_id);
+      RetirePage(r_page_id, ctx);
       ctx.write_set_.pop_back();
       ctx.index_set_.pop_back();
       //    std::cout << "Successfully merged. After merging, page: " << page->ToString() << "\n";  // debug
-      return;
+      return true;
     }
     auto l_page_id = p_page->ValueAt(l - 1);
-    auto l_page_guard = bpm_->FetchPageWrite(l_page_id);
+    auto l_page_guard = bpm_->FetchPageWrite(l_page_id, AccessType::Unknown, file_id_);
+    if (!l_page_guard.IsValid()) {
+      return false;
+    }
     auto *l_page = l_page_guard.template AsMut<InternalPage>();
+    bpm_->Unswizzle(l_page);
     //  std::cout << "Merging page: " << page->ToString() << " to l_page: " << l_page->ToString() << "\n";  // debug
     for (int i = 0; i < page->GetSize(); ++i) {
       l_page->InsertAt(l_page->GetSize(), page->PairAt(i));
     }
     page->SetSize(0);
     p_page->RemoveAt(l);
-    bpm_->DeletePage(p_page->ValueAt(l));
+    RetirePage(p_page->ValueAt(l), ctx);
     ctx.write_set_.pop_back();
     ctx.index_set_.pop_back();
     //  std::cout << "Successfully merged. After merging, l_page: " << l_page->ToString() << "\n";  // debug
+    return true;
   }
 
   /**
-   * @return whether insert successfully and if false, whether it is because leaf node unsafe.
+   * @return false if a page could not be fetched or allocated, see the public insert()
    */
-  auto insert(const KeyType &key, const ValueType &value) -> pair<bool, bool> {
+  auto insert(const KeyType &key, const ValueType &value) -> bool {
     Context ctx;
-    ctx.header_write_guard_ = bpm_->FetchPageWrite(header_page_id_);
-    ctx.root_page_id_ = ctx.header_write_guard_->AsMut<BPlusTreeHeaderPage>()->root_page_id_;
+    ctx.epoch_ = bpm_->EnterEpoch();
+    ctx.header_write_guard_ = FetchHeaderWrite();
+    if (!ctx.header_write_guard_->IsValid()) {
+      return false;
+    }
+    ctx.root_page_id_ = ctx.header_write_guard_->As<BPlusTreeHeaderPage>()->root_page_id_;
     if (ctx.root_page_id_ == INVALID_PAGE_ID) {
       page_id_t n_root_page_id;
-      auto n_root_guard = bpm_->NewPageGuarded(&n_root_page_id);
+      auto n_root_guard = bpm_->NewPageGuarded(&n_root_page_id, file_id_);
+      if (!n_root_guard.IsValid()) {
+        return false;
+      }
       auto *n_root_page = n_root_guard.AsMut<LeafPage>();
       n_root_page->Init(leaf_max_size_);
       auto *header_page = ctx.header_write_guard_->AsMut<BPlusTreeHeaderPage>();
       header_page->root_page_id_ = n_root_page_id;
       n_root_page->InsertAt(0, key, value);
-      return {true, true};
+      return true;
     }
 
-    ctx.write_set_.push_back(bpm_->FetchPageWrite(ctx.root_page_id_));
+    ctx.write_set_.push_back(FetchWrite(ctx.root_page_id_, 0, AccessType::Index));
+    if (!ctx.write_set_.back().IsValid()) {
+      return false;
+    }
     auto bpt_page = ctx.write_set_.back().AsMut<BPlusTreePage>();
+    int depth = 0;
     while (!bpt_page->IsLeafPage()) {
       if (bpt_page->GetSize() < bpt_page->GetMaxSize()) {  // safe
         while (ctx.write_set_.size() > 1) {
@@ -499,11 +944,20 @@ class BPlusTree {
       auto *internal_page = reinterpret_cast<InternalPage *>(bpt_page);
 
       auto l = UpperBound(internal_page, key) - 1;
-      ctx.write_set_.push_back(bpm_->FetchPageWrite(internal_page->ValueAt(l)));
+      ctx.write_set_.push_back(FetchChildWrite(internal_page->ValueRefAt(l), ++depth, AccessType::Index));
+      if (!ctx.write_set_.back().IsValid()) {
+        return false;
+      }
       bpt_page = ctx.write_set_.back().AsMut<BPlusTreePage>();
     }
     auto *leaf_page = reinterpret_cast<LeafPage *>(bpt_page);
 
+    if (BinarySearch(leaf_page, key) != -1) {
+      return true;
+    }
+    if (!ReserveNewPages(CountNewPages(ctx), ctx)) {
+      return false;
+    }
     if (InsertKeyValue(leaf_page, key, value)) {
       if (leaf_page->GetSize() == leaf_page->GetMaxSize()) {
         page_id_t n_page_id;
@@ -524,25 +978,32 @@ class BPlusTree {
           }
         }
       }
-      return {true, false};
     }
-    return {false, false};
+    return true;
   }
 
   /**
-   * @return whether insert successfully and if false, whether it is because leaf node unsafe.
+   * @return false if a page on the path could not be fetched, see the public remove()
    */
-  auto remove(const KeyType &key) -> pair<bool, bool> {
+  auto remove(const KeyType &key) -> bool {
     Context ctx;
+    ctx.epoch_ = bpm_->EnterEpoch();
     // 用栈模拟递归
-    ctx.header_write_guard_ = bpm_->FetchPageWrite(header_page_id_);
-    ctx.root_page_id_ = ctx.header_write_guard_->AsMut<BPlusTreeHeaderPage>()->root_page_id_;
+    ctx.header_write_guard_ = FetchHeaderWrite();
+    if (!ctx.header_write_guard_->IsValid()) {
+      return false;
+    }
+    ctx.root_page_id_ = ctx.header_write_guard_->As<BPlusTreeHeaderPage>()->root_page_id_;
     if (ctx.root_page_id_ == INVALID_PAGE_ID) {  // 空树
-      return {true, false};
+      return true;
     }
 
-    ctx.write_set_.push_back(bpm_->FetchPageWrite(ctx.root_page_id_));
+    ctx.write_set_.push_back(FetchWrite(ctx.root_page_id_, 0, AccessType::Index));
+    if (!ctx.write_set_.back().IsValid()) {
+      return false;
+    }
     auto bpt_page = ctx.write_set_.back().AsMut<BPlusTreePage>();
+    int depth = 0;
     while (!bpt_page->IsLeafPage()) {
       if (bpt_page->GetSize() > bpt_page->GetMinSize()) {  // safe
         while (ctx.write_set_.size() > 1) {
@@ -552,7 +1013,10 @@ class BPlusTree {
       }
       auto *internal_page = reinterpret_cast<InternalPage *>(bpt_page);
       auto l = UpperBound(internal_page, key) - 1;
-      ctx.write_set_.push_back(bpm_->FetchPageWrite(internal_page->ValueAt(l)));
+      ctx.write_set_.push_back(FetchChildWrite(internal_page->ValueRefAt(l), ++depth, AccessType::Index));
+      if (!ctx.write_set_.back().IsValid()) {
+        return false;
+      }
       ctx.index_set_.push_back(l);
       bpt_page = ctx.write_set_.back().AsMut<BPlusTreePage>();
     }
@@ -560,38 +1024,40 @@ class BPlusTree {
     RemoveKeyValue(leaf_page, key);
 
     if (leaf_page->GetSize() >= leaf_page->GetMinSize()) {
-      return {true, false};
+      return true;
     }
     if (ctx.IsRootPage(ctx.write_set_.back().PageId())) {  // 根就是叶子
       if (leaf_page->GetSize() == 0) {
         ctx.header_write_guard_->AsMut<BPlusTreeHeaderPage>()->root_page_id_ = INVALID_PAGE_ID;
-        bpm_->DeletePage(ctx.root_page_id_);
+        RetirePage(ctx.root_page_id_, ctx);
       }
-      return {true, false};
+      return true;
     }
-    if (TryAdoptFromNeighbor(leaf_page, ctx)) {
-      return {true, false};
+    // From here on the pair is gone, a neighbour that cannot be fetched only stops the rebalancing.
+    if (TryAdoptFromNeighbor(leaf_page, ctx) || !MergeLeafPage(leaf_page, ctx)) {
+      return true;
     }
-    MergeLeafPage(leaf_page, ctx);
     auto *page = ctx.write_set_.back().AsMut<InternalPage>();
     while (ctx.write_set_.size() > 1) {
-      if (TryAdoptFromNeighbor(page, ctx)) {
-        return {true, false};
+      if (TryAdoptFromNeighbor(page, ctx) || !MergeInternalPage(page, ctx)) {
+        return true;
       }
-      MergeInternalPage(page, ctx);
       page = ctx.write_set_.back().AsMut<InternalPage>();
     }
     // 两种可能：
     // 1. ctx.write_set_中仅剩根的写锁，这时有可能根仅剩一个儿子，需要换根
     // 2. ctx.write_set_中仅剩安全节点的写锁，什么都不用做
     if (page->GetSize() == 1) {
+      bpm_->Unswizzle(page);
       ctx.header_write_guard_->AsMut<BPlusTreeHeaderPage>()->root_page_id_ = page->ValueAt(0);
-      bpm_->DeletePage(ctx.root_page_id_);
+      RetireResidents(ctx);
+      RetirePage(ctx.root_page_id_, ctx);
     }
-    return {true, false};
+    return true;
   }
 
-  void find(const KeyType &key, vector<KeySecond> &result, ReadPageGuard &guard) {
+  template <size_t InlineN>
+  auto find(const KeyType &key, vector<KeySecond, InlineN> &result, ReadPageGuard &guard, int depth) -> bool {
     auto *page = guard.template As<BPlusTreePage>();
     if (page->IsLeafPage()) {
       auto leaf_page = reinterpret_cast<const LeafPage *>(page);
@@ -601,7 +1067,7 @@ class BPlusTree {
         result.push_back(leaf_page->KeyAt(i).second);
       }
       guard.Drop();
-      return;
+      return true;
     }
     auto internal_page = reinterpret_cast<const InternalPage *>(page);
     int l = internal_page->LowerBoundByFirst(key, comparator_) - 1;
@@ -613,18 +1079,37 @@ class BPlusTree {
     //    }
     //    guard.Drop();
     for (int i = l; i <= r; ++i) {
-      auto n_guard = bpm_->FetchPageRead(internal_page->ValueAt(i));
-      find(key, result, n_guard);
+      auto n_guard = FetchChildRead(internal_page->ValueRefAt(i), depth + 1, AccessType::Lookup);
+      if (!n_guard.IsValid() || !find(key, result, n_guard, depth + 1)) {
+        return false;
+      }
     }
+    return true;
   }
 
   // member variable
   std::string index_name_;
   BufferPoolManager *bpm_;
+  /** The file of the tree in bpm_, and whether the tree created bpm_ for itself. */
+  file_id_t file_id_{0};
+  bool owns_bpm_{false};
   KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
   page_id_t header_page_id_;
+  /** Resident top levels, see SetResidentLevels(). */
+  int resident_levels_{0};
+  size_t resident_capacity_{0};
+  Page *header_frame_{nullptr};
+  /** The direct-mapped resident page cache, indexed by page id: the frame pinned for a slot, nullptr if it is free. */
+  std::atomic<Page *> resident_[RESIDENT_CACHE_SIZE]{};
+
+  StripedCounter finds_;
+  StripedCounter inserts_;
+  StripedCounter removes_;
+  StripedCounter find_fetches_;
+  StripedCounter insert_fetches_;
+  StripedCounter remove_fetches_;
 };
 
 template <class KeyType, class ValueType>
@@ -3,28 +3,48 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include <algorithm>
 #include "storage/page/b_plus_tree_leaf_page.h"
 
 namespace CrazyDave {
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 
+/**
+ * Range scans walk the leaf chain, so once the iterator crosses into a second leaf it starts reading ahead: up to
+ * ra_window_ leaves past the current one are handed to BufferPoolManager::Prefetch(). The page id of a leaf is only
+ * known once its left neighbor is in memory, so the read-ahead frontier advances as far as the prefetched leaves
+ * have arrived each time a leaf is crossed.
+ *
+ * The window adapts to how fast the scan is consumed. Arriving at a leaf that is still being read means the scan
+ * outruns the i/o and the window doubles. Arriving at a leaf that was requested but is gone means the prefetched
+ * leaves were evicted before use and the window halves.
+ *
+ * A leaf that cannot be fetched, the buffer pool having no frame to give, ends the scan early: IsEnd() turns true and
+ * IsFailed() tells it apart from the end of the tree.
+ */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class IndexIterator {
  public:
   // you may define your own constructor based on your member variables
-  IndexIterator(BufferPoolManager *buffer_pool_manager, page_id_t page_id, int pos = 0)
-      : bpm_(buffer_pool_manager), page_id_(page_id), pos_(pos) {
+  IndexIterator(BufferPoolManager *buffer_pool_manager, file_id_t file_id, page_id_t page_id, int pos = 0)
+      : bpm_(buffer_pool_manager), file_id_(file_id), page_id_(page_id), pos_(pos) {
     if (page_id == INVALID_PAGE_ID) {
       is_end_ = true;
     } else {
-      guard_ = bpm_->FetchPageRead(page_id);
+      guard_ = bpm_->FetchPageRead(page_id, AccessType::Scan, file_id_);
+      if (!guard_.IsValid()) {
+        Fail();
+      }
     }
   }
   ~IndexIterator() = default;  // NOLINT
 
   auto IsEnd() -> bool{ return is_end_; }
 
+  /** @return true if the scan ended before the end of the tree, a leaf on the way could not be fetched */
+  auto IsFailed() -> bool { return failed_; }
+
   auto operator*() -> const MappingType &{
     auto *page = guard_.As<B_PLUS_TREE_LEAF_PAGE_TYPE>();
     return page->PairAt(pos_);
@@ -44,14 +64,23 @@ class IndexIterator {
       if (next_page_id == INVALID_PAGE_ID) {
         is_end_ = true;
       } else {
-        guard_ = bpm_->FetchPageRead(next_page_id);
+        guard_ = bpm_->TryFetchPageRead(next_page_id, AccessType::Scan, file_id_);
+        AdaptReadAhead(guard_.IsValid());
+        if (!guard_.IsValid()) {
+          guard_ = bpm_->FetchPageRead(next_page_id, AccessType::Scan, file_id_);
+        }
+        if (!guard_.IsValid()) {
+          Fail();
+          return *this;
+        }
+        ReadAhead();
       }
     }
     return *this;
   }
 
   auto operator==(const IndexIterator &itr) const -> bool {
-    if (bpm_ != itr.bpm_) {
+    if (bpm_ != itr.bpm_ || file_id_ != itr.file_id_) {
       return false;
     }
     if (is_end_) {
@@ -63,12 +92,73 @@ class IndexIterator {
   auto operator!=(const IndexIterator &itr) const -> bool { return !(this->operator==(itr)); }
 
  private:
+  void Fail() {
+    is_end_ = true;
+    failed_ = true;
+    page_id_ = INVALID_PAGE_ID;
+  }
+
+  /** Called after stepping into page_id_, hit tells whether it could be read without waiting. */
+  void AdaptReadAhead(bool hit) {
+    if (ra_window_ == 0) {
+      // Second leaf of the scan, it is sequential.
+      ra_window_ = READ_AHEAD_MIN_WINDOW;
+      ra_frontier_ = page_id_;
+      ra_ahead_ = 0;
+      return;
+    }
+    if (ra_ahead_ == 0) {
+      // We caught up with the frontier.
+      ra_frontier_ = page_id_;
+      if (!hit) {
+        ra_window_ = std::min(ra_window_ * 2, READ_AHEAD_MAX_WINDOW);
+      }
+      return;
+    }
+    --ra_ahead_;
+    if (!hit) {
+      if (bpm_->IsResident(page_id_, file_id_)) {
+        ra_window_ = std::min(ra_window_ * 2, READ_AHEAD_MAX_WINDOW);
+      } else {
+        ra_window_ = std::max(ra_window_ / 2, READ_AHEAD_MIN_WINDOW);
+      }
+    }
+  }
+
+  /** Push the frontier forward until ra_window_ leaves are requested or an unread leaf blocks the way. */
+  void ReadAhead() {
+    while (ra_ahead_ < ra_window_) {
+      page_id_t next_page_id;
+      if (ra_frontier_ == page_id_) {
+        next_page_id = guard_.As<B_PLUS_TREE_LEAF_PAGE_TYPE>()->GetNextPageId();
+      } else {
+        auto frontier_guard = bpm_->TryFetchPageRead(ra_frontier_, AccessType::Scan, file_id_);
+        if (!frontier_guard.IsValid()) {
+          return;
+        }
+        next_page_id = frontier_guard.template As<B_PLUS_TREE_LEAF_PAGE_TYPE>()->GetNextPageId();
+      }
+      if (next_page_id == INVALID_PAGE_ID) {
+        return;
+      }
+      bpm_->Prefetch(next_page_id, AccessType::Scan, file_id_);
+      ra_frontier_ = next_page_id;
+      ++ra_ahead_;
+    }
+  }
+
   // add your own private member variables here
   BufferPoolManager *bpm_;
+  file_id_t file_id_;
   ReadPageGuard guard_;
   page_id_t page_id_;
   int pos_{0};
   bool is_end_{false};
+  bool failed_{false};
+  /** Read-ahead state: window size (0 until the scan crosses a leaf), farthest leaf requested and its distance. */
+  int ra_window_{0};
+  page_id_t ra_frontier_{INVALID_PAGE_ID};
+  int ra_ahead_{0};
 };
 
 }  // namespace CrazyDave
@@ -72,6 +72,12 @@ class BPlusTreeInternalPage : public BPlusTreePage {
    */
   auto ValueAt(int index) const -> ValueType { return array_[index].second; }
 
+  /**
+   * @param index the index
+   * @return address of the value at the index, for BufferPoolManager::FetchChild() which may swizzle it
+   */
+  auto ValueRefAt(int index) const -> const ValueType * { return &array_[index].second; }
+
   void InsertAt(int index, const KeyType &key, const ValueType &value) {
     for (int i = GetSize(); i > index; --i) {
       array_[i] = array_[i - 1];
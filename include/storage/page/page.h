@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
@@ -12,22 +13,21 @@ namespace CrazyDave {
  * Page is the basic unit of storage within the database system. Page provides a wrapper for actual data pages being
  * held in main memory. Page also contains book-keeping information that is used by the buffer pool manager, e.g.
  * pin count, dirty flag, page id, etc.
+ *
+ * Pages are the control blocks of the frames and sit next to each other in one array, apart from the page data.
+ * Each takes whole cache lines, so that pinning a hot frame, like the root or an inner page of a tree, does not
+ * invalidate the line of its neighbour on every other core.
  */
-class Page {
+class alignas(CACHE_LINE_SIZE) Page {
   // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
   friend class BufferPoolManager;
 
  public:
-  /** Constructor. Zeros out the page data. */
-  Page() {
-    //    data_ = new char[BUSTUB_PAGE_SIZE]{};
-    //    ResetMemory();
-  }
+  /** Constructor. The page data is owned by the buffer pool manager's frame arena and attached afterwards. */
+  Page() = default;
 
   /** Default destructor. */
-  ~Page() {
-    //    delete[] data_;
-  }
+  ~Page() = default;
 
   /** @return the actual data contained within this page */
   inline auto GetData() -> char * { return data_; }
@@ -35,11 +35,14 @@ class Page {
   /** @return the page id of this page */
   inline auto GetPageId() const -> page_id_t { return page_id_; }
 
+  /** @return the id of the file this page belongs to, within its buffer pool */
+  inline auto GetFileId() const -> file_id_t { return file_id_; }
+
   /** @return the pin count of this page */
-  inline auto GetPinCount() const -> int { return pin_count_; }
+  inline auto GetPinCount() const -> int { return pin_count_.load(std::memory_order_relaxed); }
 
   /** @return true if the page in memory has been modified from the page on disk, false otherwise */
-  inline auto IsDirty() const -> bool { return is_dirty_; }
+  inline auto IsDirty() const -> bool { return is_dirty_.load(std::memory_order_relaxed); }
 
   /** Acquire the page write latch. */
   inline void WLatch() { rwlatch_.WLock(); }
@@ -62,14 +65,33 @@ class Page {
   /** Zeroes out the data that is held within the page. */
   inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, BUSTUB_PAGE_SIZE); }
 
-  /** The actual data that is stored within a page. */
-  char data_[BUSTUB_PAGE_SIZE]{};
+  /** The actual data that is stored within a page, pointing into the buffer pool's aligned frame arena. */
+  char *data_{nullptr};
   /** The ID of this page. */
   page_id_t page_id_ = INVALID_PAGE_ID;
-  /** The pin count of this page. */
-  int pin_count_ = 0;
+  /** The file of this page, a page is identified by (file_id_, page_id_) within its buffer pool. */
+  file_id_t file_id_ = 0;
+  /**
+   * The pin count of this page, -1 while the frame is claimed by the buffer pool manager for eviction or reuse or
+   * sits in the free list. Pins and unpins of a resident frame are single atomic operations, see
+   * BufferPoolManager::TryPin().
+   */
+  std::atomic<int> pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
-  bool is_dirty_ = false;
+  std::atomic<bool> is_dirty_ = false;
+  /** True while the background evictor writes this frame back; cleared by any fetch in the meantime. */
+  bool evicting_ = false;
+  /** True while a prefetch is reading the page into this frame; fetches wait until it is cleared. */
+  bool io_pending_ = false;
+  /**
+   * Pointer swizzling links, frame ids or -1. A swizzled child records the frame of the parent holding its tagged
+   * reference and the byte offset of that reference, and is a member of the parent's list of swizzled children.
+   */
+  frame_id_t swizzle_parent_ = -1;
+  uint32_t swizzle_offset_ = 0;
+  frame_id_t swizzle_head_ = -1;
+  frame_id_t swizzle_prev_ = -1;
+  frame_id_t swizzle_next_ = -1;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
 };
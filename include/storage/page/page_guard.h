@@ -12,6 +12,12 @@ class BasicPageGuard {
 
   BasicPageGuard(BufferPoolManager *bpm, Page *page) : bpm_(bpm), page_(page) {}
 
+  /**
+   * @brief Guard a frame that is pinned for good by its owner, see BufferPoolManager::PinResident(). Dropping the
+   * guard does not unpin the frame, it only reports the page dirty if it was written.
+   */
+  BasicPageGuard(BufferPoolManager *bpm, Page *page, bool resident) : bpm_(bpm), page_(page), resident_(resident) {}
+
   BasicPageGuard(const BasicPageGuard &) = delete;
   auto operator=(const BasicPageGuard &) -> BasicPageGuard & = delete;
 
@@ -59,6 +65,9 @@ class BasicPageGuard {
    */
   ~BasicPageGuard();
 
+  /** @return false if the guard holds no page, e.g. it was dropped or the fetch failed */
+  [[nodiscard]] auto IsValid() const -> bool { return page_ != nullptr; }
+
   [[nodiscard]] auto PageId() const -> page_id_t { return page_->GetPageId(); }
 
   [[nodiscard]] auto GetData() const -> char * { return page_->GetData(); }
@@ -85,12 +94,14 @@ class BasicPageGuard {
   BufferPoolManager *bpm_{nullptr};
   Page *page_{nullptr};
   bool is_dirty_{false};
+  bool resident_{false};
 };
 
 class ReadPageGuard {
  public:
   ReadPageGuard() = default;
   ReadPageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {}
+  ReadPageGuard(BufferPoolManager *bpm, Page *page, bool resident) : guard_(bpm, page, resident) {}
   ReadPageGuard(const ReadPageGuard &) = delete;
   auto operator=(const ReadPageGuard &) -> ReadPageGuard & = delete;
 
@@ -133,6 +144,8 @@ class ReadPageGuard {
    */
   ~ReadPageGuard();
 
+  [[nodiscard]] auto IsValid() const -> bool { return guard_.IsValid(); }
+
   auto PageId() -> page_id_t { return guard_.PageId(); }
 
   auto GetData() -> const char * { return guard_.GetData(); }
@@ -151,6 +164,7 @@ class WritePageGuard {
  public:
   WritePageGuard() = default;
   WritePageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {}
+  WritePageGuard(BufferPoolManager *bpm, Page *page, bool resident) : guard_(bpm, page, resident) {}
   WritePageGuard(const WritePageGuard &) = delete;
   auto operator=(const WritePageGuard &) -> WritePageGuard & = delete;
 
@@ -193,6 +207,8 @@ class WritePageGuard {
    */
   ~WritePageGuard();
 
+  [[nodiscard]] auto IsValid() const -> bool { return guard_.IsValid(); }
+
   [[nodiscard]] auto PageId() const -> page_id_t { return guard_.PageId(); }
 
   [[nodiscard]] auto GetData() const -> const char * { return guard_.GetData(); }
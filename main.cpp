@@ -1,15 +1,27 @@
+#include <csignal>
+#include <cstdlib>
 #include <iostream>
 #include "common/utils.h"
 #include "data_structures/vector.h"
 #include "storage/index/b_plus_tree.h"
 
+// Set by SIGUSR1, the statistics are printed to stderr before the next command.
+volatile std::sig_atomic_t stats_requested = 0;
+
+void RequestStats(int /*signal*/) { stats_requested = 1; }
+
 auto main() -> int {
   std::ios::sync_with_stdio(false);
+  std::signal(SIGUSR1, RequestStats);
   //  CrazyDave::BPlusTree<CrazyDave::pair<uint64_t, int>, int, CrazyDave::Comparator<uint64_t, int, int>> bpt("my_bpt",
   //  0,
   //                                                                                                           3000,
   //                                                                                                           30);
   CrazyDave::BPT<CrazyDave::String<65>, int> bpt("my_bpt", 0, 300, 30);
+  // BPT_TRACE=<file> logs the page accesses of the run for tools/replacer_simulator.
+  if (const char *trace = std::getenv("BPT_TRACE"); trace != nullptr && !bpt.StartTrace(trace)) {
+    std::cerr << "cannot open trace file " << trace << "\n";
+  }
   //  CrazyDave::BPlusTree<CrazyDave::pair<CrazyDave::String<65>, int>, int,
   //                       CrazyDave::Comparator<CrazyDave::String<65>, int, int>>
   //      bpt("my_bpt", 0, 300, 30);
@@ -20,6 +32,10 @@ auto main() -> int {
   int n;
   std::cin >> n;
   while (n--) {
+    if (stats_requested != 0) {
+      stats_requested = 0;
+      bpt.GetStats().Dump(std::cerr);
+    }
     CrazyDave::String<65> op, index;
     int value;
     std::cin >> op;
@@ -27,19 +43,25 @@ auto main() -> int {
       std::cin >> index >> value;
       //      auto index_hs = CrazyDave::HashBytes(index.c_str());
       //      bpt.Insert({index_hs, value}, 0);
-      bpt.insert(index, value);
+      if (!bpt.insert(index, value)) {
+        std::cerr << "insert failed: no buffer pool frame available\n";
+      }
     } else if (op[0] == 'd') {
       std::cin >> index >> value;
       //      auto index_hs = CrazyDave::HashBytes(index.c_str());
       //      bpt.Remove({index_hs, value});
-      bpt.remove(index, value);
+      if (!bpt.remove(index, value)) {
+        std::cerr << "delete failed: no buffer pool frame available\n";
+      }
     } else {
       std::cin >> index;
       //      auto index_hs = CrazyDave::HashBytes(index.c_str());
       //      CrazyDave::vector<CrazyDave::pair<uint64_t, int>> res;
       //      bpt.Find({index_hs, 0}, &res);
-      CrazyDave::vector<int> res;
-      bpt.find(index, res);
+      CrazyDave::vector<int, CrazyDave::QUERY_RESULT_INLINE_SIZE> res;
+      if (!bpt.find(index, res)) {
+        std::cerr << "find failed: no buffer pool frame available\n";
+      }
       for (auto x : res) {
         std::cout << x << ' ';
       }
@@ -49,5 +71,9 @@ auto main() -> int {
       std::cout << std::endl;
     }
   }
+  // BPT_STATS=1 prints the statistics once all commands are done.
+  if (std::getenv("BPT_STATS") != nullptr) {
+    bpt.GetStats().Dump(std::cerr);
+  }
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include "buffer/access_tracer.h"
+
+namespace CrazyDave {
+
+auto AccessTracer::Start(const std::string &path) -> bool {
+  Stop();
+  std::scoped_lock lock(latch_);
+  file_.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!file_.is_open()) {
+    return false;
+  }
+  file_.write(reinterpret_cast<const char *>(&TRACE_MAGIC), sizeof(TRACE_MAGIC));
+  buffer_.reserve(TRACE_BUFFER_SIZE);
+  record_count_.store(0, std::memory_order_relaxed);
+  enabled_.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+void AccessTracer::Stop() {
+  std::scoped_lock lock(latch_);
+  if (!file_.is_open()) {
+    return;
+  }
+  enabled_.store(false, std::memory_order_relaxed);
+  FlushBuffer();
+  file_.close();
+}
+
+void AccessTracer::Append(const TraceRecord &record) {
+  std::scoped_lock lock(latch_);
+  // The trace may have been stopped since the caller checked.
+  if (!file_.is_open()) {
+    return;
+  }
+  buffer_.push_back(record);
+  record_count_.fetch_add(1, std::memory_order_relaxed);
+  if (buffer_.size() >= TRACE_BUFFER_SIZE) {
+    FlushBuffer();
+  }
+}
+
+void AccessTracer::FlushBuffer() {
+  if (!buffer_.empty()) {
+    file_.write(reinterpret_cast<const char *>(&buffer_[0]),
+                static_cast<std::streamsize>(buffer_.size() * sizeof(TraceRecord)));
+    buffer_.clear();
+  }
+}
+
+}  // namespace CrazyDave
@@ -0,0 +1,174 @@
+#include "buffer/arc_replacer.h"
+#include <algorithm>
+
+namespace CrazyDave {
+
+ARCReplacer::ARCReplacer(size_t num_frames) : capacity_(num_frames) {
+  entries_.reserve(num_frames);
+  for (size_t i = 0; i < num_frames; ++i) {
+    entries_.push_back({});
+  }
+}
+
+void ARCReplacer::Link(frame_id_t frame_id, int list) {
+  auto &entry = entries_[frame_id];
+  entry.list_ = list;
+  entry.prev_ = tail_[list];
+  entry.next_ = -1;
+  if (tail_[list] != -1) {
+    entries_[tail_[list]].next_ = frame_id;
+  } else {
+    head_[list] = frame_id;
+  }
+  tail_[list] = frame_id;
+  ++size_[list];
+}
+
+void ARCReplacer::Unlink(frame_id_t frame_id) {
+  auto &entry = entries_[frame_id];
+  int list = entry.list_;
+  if (entry.prev_ != -1) {
+    entries_[entry.prev_].next_ = entry.next_;
+  } else {
+    head_[list] = entry.next_;
+  }
+  if (entry.next_ != -1) {
+    entries_[entry.next_].prev_ = entry.prev_;
+  } else {
+    tail_[list] = entry.prev_;
+  }
+  entry.prev_ = entry.next_ = -1;
+  entry.list_ = NONE;
+  --size_[list];
+}
+
+auto ARCReplacer::FindVictim(int list, const std::function<auto(frame_id_t)->bool> &evictable) -> frame_id_t {
+  for (auto fid = head_[list]; fid != -1; fid = entries_[fid].next_) {
+    ++stats_.frames_scanned_;
+    if (evictable ? evictable(fid) : entries_[fid].is_evictable_) {
+      return fid;
+    }
+  }
+  return -1;
+}
+
+void ARCReplacer::AddGhost(int list, page_key_t page_key) {
+  if (page_key == INVALID_PAGE_KEY) {
+    return;
+  }
+  ghosts_[list].insert({page_key, true});
+  TrimGhosts();
+}
+
+void ARCReplacer::TrimGhosts() {
+  // |T1| + |B1| <= c and |T1| + |T2| + |B1| + |B2| <= 2c.
+  while (!ghosts_[T1].empty() && size_[T1] + ghosts_[T1].size() > capacity_) {
+    ghosts_[T1].erase(ghosts_[T1].begin());
+  }
+  while ((!ghosts_[T1].empty() || !ghosts_[T2].empty()) &&
+         size_[T1] + size_[T2] + ghosts_[T1].size() + ghosts_[T2].size() > 2 * capacity_) {
+    auto &ghosts = ghosts_[T2].empty() ? ghosts_[T1] : ghosts_[T2];
+    ghosts.erase(ghosts.begin());
+  }
+}
+
+auto ARCReplacer::Evict(frame_id_t *frame_id, const std::function<auto(frame_id_t)->bool> &evictable) -> bool {
+  int first = size_[T1] > 0 && size_[T1] >= std::max<size_t>(target_, 1) ? T1 : T2;
+  int list = first;
+  frame_id_t victim = FindVictim(first, evictable);
+  if (victim == -1) {
+    list = 1 - first;
+    victim = FindVictim(list, evictable);
+  }
+  if (victim == -1) {
+    ++stats_.failed_evictions_;
+    return false;
+  }
+  ++stats_.evictions_;
+  page_key_t page_key = entries_[victim].page_key_;
+  Remove(victim);
+  AddGhost(list, page_key);
+  *frame_id = victim;
+  return true;
+}
+
+void ARCReplacer::RecordAccess(frame_id_t frame_id, AccessType access_type, page_key_t page_key) {
+  auto &entry = entries_[frame_id];
+  if (entry.list_ != NONE) {
+    // Hit: a second access moves the frame to T2, a scan access leaves it where it is.
+    if (access_type != AccessType::Scan) {
+      Unlink(frame_id);
+      Link(frame_id, T2);
+    }
+    return;
+  }
+  entry.page_key_ = page_key;
+  if (page_key != INVALID_PAGE_KEY) {
+    for (int list : {T1, T2}) {
+      auto it = ghosts_[list].find(page_key);
+      if (it == ghosts_[list].end()) {
+        continue;
+      }
+      size_t b1 = ghosts_[T1].size();
+      size_t b2 = ghosts_[T2].size();
+      if (list == T1) {
+        target_ = std::min(capacity_, target_ + std::max<size_t>(1, b2 / b1));
+      } else {
+        size_t delta = std::max<size_t>(1, b1 / b2);
+        target_ = target_ > delta ? target_ - delta : 0;
+      }
+      ghosts_[list].erase(it);
+      Link(frame_id, T2);
+      return;
+    }
+  }
+  Link(frame_id, T1);
+}
+
+void ARCReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
+  auto &entry = entries_[frame_id];
+  if (entry.is_evictable_ != set_evictable) {
+    if (set_evictable) {
+      ++curr_size_;
+    } else {
+      --curr_size_;
+    }
+  }
+  entry.is_evictable_ = set_evictable;
+}
+
+void ARCReplacer::Remove(frame_id_t frame_id) {
+  auto &entry = entries_[frame_id];
+  if (entry.list_ == NONE) {
+    return;
+  }
+  Unlink(frame_id);
+  if (entry.is_evictable_) {
+    --curr_size_;
+  }
+  entry = {};
+}
+
+void ARCReplacer::SetCapacity(size_t num_frames) {
+  while (entries_.size() > num_frames) {
+    Remove(static_cast<frame_id_t>(entries_.size() - 1));
+    entries_.pop_back();
+  }
+  while (entries_.size() < num_frames) {
+    entries_.push_back({});
+  }
+  capacity_ = num_frames;
+  target_ = std::min(target_, capacity_);
+  TrimGhosts();
+}
+
+void ARCReplacer::GetHotFrames(vector<frame_id_t> *frames) {
+  // Frequently used frames first, each list from its most recently used end.
+  for (int list : {T2, T1}) {
+    for (auto fid = tail_[list]; fid != -1; fid = entries_[fid].prev_) {
+      frames->push_back(fid);
+    }
+  }
+}
+
+}  // namespace CrazyDave
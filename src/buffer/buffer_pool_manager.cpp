@@ -1,175 +1,1154 @@
 #include "buffer/buffer_pool_manager.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <ostream>
+#include <sys/mman.h>
 #include "storage/page/page_guard.h"
 
 namespace CrazyDave {
 
-BufferPoolManager::BufferPoolManager(const std::string &name, size_t pool_size, size_t replacer_k)
-    : pool_size_(pool_size) {
-  // we allocate a consecutive memory space for the buffer pool
-  disk_manager_ = new MyDiskManager{name};
-  pages_ = new Page[pool_size_];
-  replacer_ = new LRUKReplacer{pool_size, replacer_k};
+BufferPoolManager::BufferPoolManager(const std::string &name, size_t pool_size, size_t replacer_k, bool direct_io,
+                                     ReplacerType replacer_type)
+    : BufferPoolManager(pool_size, replacer_k, direct_io, replacer_type) {
+  OpenFile(name);
+}
+
+BufferPoolManager::BufferPoolManager(size_t pool_size, size_t replacer_k, bool direct_io, ReplacerType replacer_type)
+    : pool_size_(0),
+      max_pool_size_(std::max<size_t>(pool_size, MAX_BUFFER_POOL_SIZE)),
+      direct_io_(direct_io),
+      page_table_(pool_size),
+      epoch_manager_([this](page_id_t page_id, file_id_t file_id) { return DeletePage(page_id, file_id); },
+                     [this](Page *page) { ReleaseResident(page); }) {
+  // We reserve a consecutive address space for the frames up to max_pool_size_, and commit the first pool_size
+  // frames of it. Frames therefore never move when the pool grows or shrinks.
+  pages_ = static_cast<Page *>(mmap(nullptr, max_pool_size_ * sizeof(Page), PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+  // The frame metadata is what the replacer, the flusher and resizes scan, keep it on few TLB entries too.
+  madvise(pages_, max_pool_size_ * sizeof(Page), MADV_HUGEPAGE);
+  MapArena();
+  io_buffer_ = static_cast<char *>(std::aligned_alloc(FRAME_ALIGNMENT, BUSTUB_PAGE_SIZE));
+  replacer_ = MakeReplacer(replacer_type, pool_size, replacer_k);
 
   // Initially, every page is in the free list.
-  for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_.push_back(static_cast<int>(i));
-  }
+  GrowFrames(pool_size);
 }
 
 BufferPoolManager::~BufferPoolManager() {
+  {
+    std::scoped_lock lock(latch_);
+    prefetcher_stop_ = true;
+  }
+  prefetch_queue_.close();
+  if (warmer_.joinable()) {
+    warmer_.join();
+  }
+  if (prefetcher_running_) {
+    prefetcher_.join();
+  }
+  StopEvictor();
+  StopFlusher();
+  epoch_manager_.ReclaimAll();
+  SaveHotPages();
   FlushAllPages();
-  delete[] pages_;
+  for (size_t i = 0; i < constructed_frames_; ++i) {
+    pages_[i].~Page();
+  }
+  munmap(pages_, max_pool_size_ * sizeof(Page));
+  munmap(frame_arena_, arena_size_);
+  std::free(io_buffer_);
   delete replacer_;
-  delete disk_manager_;
+  for (size_t i = 0; i < file_count_; ++i) {
+    delete files_[i];
+  }
 }
 
-auto BufferPoolManager::NewPage(page_id_t *page_id) -> Page * {
-  frame_id_t fid;
-  if (!free_list_.empty()) {
-    fid = free_list_.front();
+auto BufferPoolManager::OpenFile(const std::string &name) -> file_id_t {
+  std::scoped_lock lock(latch_);
+  for (size_t i = 0; i < file_count_; ++i) {
+    if (file_names_[i] == name) {
+      return static_cast<file_id_t>(i);
+    }
+  }
+  if (file_count_ == MAX_FILES) {
+    return INVALID_FILE_ID;
+  }
+  auto file_id = static_cast<file_id_t>(file_count_);
+  auto *file = new MyDiskManager{name, direct_io_};
+  files_[file_count_] = file;
+  file_names_[file_count_] = name;
+  ++file_count_;
+
+  // A hot page list left next to a new data file belongs to an older file of that name, its pages do not exist.
+  vector<page_id_t> hot_pages;
+  if (!file->IsNew()) {
+    file->LoadHotPages(&hot_pages, free_list_.size());
+  }
+  if (hot_pages.empty() || prefetcher_stop_) {
+    return file_id;
+  }
+  // Read them in page id order, so that the disk sees runs of neighbouring pages.
+  hot_pages.sort([](const page_id_t &a, const page_id_t &b) { return a < b; });
+  for (size_t i = 0; i < hot_pages.size(); ++i) {
+    warm_up_.push_back({hot_pages[i], file_id, AccessType::Unknown});
+  }
+  StartPrefetcher();
+  if (!warmer_running_) {
+    if (warmer_.joinable()) {
+      warmer_.join();
+    }
+    warmer_running_ = true;
+    warmer_ = std::thread(&BufferPoolManager::WarmUpLoop, this);
+  }
+  return file_id;
+}
+
+void BufferPoolManager::SaveHotPages() {
+  vector<vector<page_id_t>> hot_pages;
+  std::unique_lock lock(latch_);
+  DrainAccesses();
+  vector<frame_id_t> frames;
+  replacer_->GetHotFrames(&frames);
+  for (size_t i = 0; i < file_count_; ++i) {
+    hot_pages.push_back({});
+  }
+  for (size_t i = 0; i < frames.size(); ++i) {
+    auto &frame = pages_[frames[i]];
+    if (frame.page_id_ != INVALID_PAGE_ID && !frame.io_pending_) {
+      hot_pages[frame.file_id_].push_back(frame.page_id_);
+    }
+  }
+  size_t file_count = file_count_;
+  lock.unlock();
+  for (size_t i = 0; i < file_count; ++i) {
+    files_[i]->SaveHotPages(hot_pages[i]);
+  }
+}
+
+void BufferPoolManager::WarmUpLoop() {
+  PrefetchRequest batch[WARM_UP_BATCH];
+  while (true) {
+    size_t count = 0;
+    {
+      std::scoped_lock lock(latch_);
+      // Only fill free frames: evicting a page that is in use for one that might be is no gain.
+      size_t queued = prefetch_queue_.size();
+      while (!prefetcher_stop_ && count < WARM_UP_BATCH && !warm_up_.empty() &&
+             queued + count < free_list_.size()) {
+        batch[count++] = warm_up_.front();
+        warm_up_.pop_front();
+      }
+      if (count == 0) {
+        warm_up_.clear();
+        warmer_running_ = false;
+        return;
+      }
+    }
+    for (size_t i = 0; i < count; ++i) {
+      if (!prefetch_queue_.push_wait(batch[i])) {
+        std::scoped_lock lock(latch_);
+        warm_up_.clear();
+        warmer_running_ = false;
+        return;
+      }
+    }
+  }
+}
+
+void BufferPoolManager::SetFileQuota(file_id_t file_id, size_t frames) {
+  std::scoped_lock lock(latch_);
+  file_quotas_[file_id] = frames;
+}
+
+void BufferPoolManager::InstallPage(frame_id_t frame_id, page_id_t page_id, file_id_t file_id) {
+  auto &frame = pages_[frame_id];
+  frame.page_id_ = page_id;
+  frame.file_id_ = file_id;
+  page_table_[PageKey(file_id, page_id)] = frame_id;
+  ++file_frames_[file_id];
+}
+
+void BufferPoolManager::DropPage(frame_id_t frame_id) {
+  auto &frame = pages_[frame_id];
+  UnswizzleFrame(frame_id);
+  page_table_.erase(page_table_.find(PageKey(frame.file_id_, frame.page_id_)));
+  --file_frames_[frame.file_id_];
+  frame.page_id_ = INVALID_PAGE_ID;
+}
+
+void BufferPoolManager::SetDirty(Page &frame) {
+  if (!frame.is_dirty_.exchange(true)) {
+    dirty_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void BufferPoolManager::SetClean(Page &frame) {
+  if (frame.is_dirty_.exchange(false)) {
+    dirty_count_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+auto BufferPoolManager::EvictFrame(frame_id_t *frame_id, file_id_t file_id) -> bool {
+  DrainAccesses();
+  auto unpinned = [this, file_id](frame_id_t fid) {
+    auto &frame = pages_[fid];
+    return frame.pin_count_.load(std::memory_order_relaxed) == 0 &&
+           (file_id == INVALID_FILE_ID || frame.file_id_ == file_id);
+  };
+  while (replacer_->Evict(frame_id, unpinned)) {
+    if (Claim(pages_[*frame_id])) {
+      return true;
+    }
+    // A TryPin() got in between, keep tracking the frame. Without the page id, which ARC would take for a hit on
+    // the ghost Evict() just left.
+    replacer_->RecordAccess(*frame_id);
+  }
+  return false;
+}
+
+auto BufferPoolManager::AcquireFrame(frame_id_t *frame_id, file_id_t file_id) -> bool {
+  bool at_quota = file_quotas_[file_id] != 0 && file_frames_[file_id] >= file_quotas_[file_id];
+  if (at_quota) {
+    if (!EvictFrame(frame_id, file_id)) {
+      return false;
+    }
+  } else if (!free_list_.empty()) {
+    *frame_id = free_list_.front();
     free_list_.pop_front();
+    if (evictor_running_ && free_list_.size() < evictor_low_watermark_) {
+      KickEvictor();
+    }
+    return true;
   } else {
-    if (replacer_->Evict(&fid)) {
-      if (pages_[fid].IsDirty()) {
-        disk_manager_->WritePage(pages_[fid].page_id_, pages_[fid].GetData());
-        pages_[fid].is_dirty_ = false;
-      }
-      page_table_.erase(page_table_.find(pages_[fid].page_id_));
-    } else {
-      return nullptr;
+    if (evictor_running_) {
+      KickEvictor();
+    }
+    if (!EvictFrame(frame_id)) {
+      return false;
     }
   }
-  auto pid = disk_manager_->AllocatePage();
+  auto &frame = pages_[*frame_id];
+  if (frame.IsDirty()) {
+    if (!WriteFrame(frame)) {
+      // The page keeps its frame and stays dirty, a later write-back may succeed. Tracked again without the page
+      // id, see EvictFrame().
+      frame.pin_count_ = 0;
+      replacer_->RecordAccess(*frame_id);
+      return false;
+    }
+    SetClean(frame);
+    sync_write_backs_.Add();
+  }
+  foreground_evictions_.Add();
+  DropPage(*frame_id);
+  return true;
+}
+
+auto BufferPoolManager::WaitForFrame(frame_id_t *frame_id, file_id_t file_id, std::unique_lock<std::mutex> &lock,
+                                     bool *waited) -> bool {
+  *waited = false;
+  if (AcquireFrame(frame_id, file_id)) {
+    return true;
+  }
+  if (frame_wait_timeout_.count() == 0) {
+    return false;
+  }
+  *waited = true;
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + frame_wait_timeout_;
+  // Announce the wait before trying again, an unpin after the attempt then sees it and notifies under latch_. The
+  // fence keeps the relaxed pin count loads of the attempt from being ordered before the announcement.
+  frame_waiters_.fetch_add(1, std::memory_order_seq_cst);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  bool acquired;
+  while (!(acquired = AcquireFrame(frame_id, file_id))) {
+    if (frame_cv_.wait_until(lock, deadline) == std::cv_status::timeout) {
+      acquired = AcquireFrame(frame_id, file_id);
+      break;
+    }
+  }
+  frame_waiters_.fetch_sub(1, std::memory_order_relaxed);
+  frame_waits_.Add();
+  frame_wait_us_.Add(
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+  return acquired;
+}
+
+void BufferPoolManager::KickEvictor() {
+  if (!evictor_kicked_) {
+    evictor_kicked_ = true;
+    evictor_cv_.notify_one();
+  }
+}
+
+auto BufferPoolManager::WriteSorted(vector<pair<uint64_t, const char *>> *pages) -> bool {
+  pages->sort([](const pair<uint64_t, const char *> &a, const pair<uint64_t, const char *> &b) {
+    return a.first < b.first;
+  });
+  bool written = true;
+  vector<page_id_t> page_ids;
+  vector<const char *> data;
+  for (size_t i = 0; i < pages->size();) {
+    auto file_id = static_cast<file_id_t>((*pages)[i].first >> 32);
+    page_ids.clear();
+    data.clear();
+    for (; i < pages->size() && static_cast<file_id_t>((*pages)[i].first >> 32) == file_id; ++i) {
+      page_ids.push_back(static_cast<page_id_t>((*pages)[i].first));
+      data.push_back((*pages)[i].second);
+    }
+    written &= files_[file_id]->WritePages(&page_ids[0], &data[0], page_ids.size());
+  }
+  return written;
+}
+
+auto BufferPoolManager::NewPage(page_id_t *page_id, file_id_t file_id) -> Page * {
+  std::unique_lock lock(latch_);
+  frame_id_t fid;
+  bool waited;
+  if (!WaitForFrame(&fid, file_id, lock, &waited)) {
+    fetch_failures_.Add();
+    return nullptr;
+  }
+  new_pages_.Add();
+  auto pid = files_[file_id]->AllocatePage();
   auto &frame = pages_[fid];
-  frame.page_id_ = pid;
-  frame.pin_count_ = 0;
+  InstallPage(fid, pid, file_id);
   frame.is_dirty_ = false;
-  page_table_[pid] = fid;
+  frame.pin_count_ = 1;
   *page_id = pid;
-  replacer_->RecordAccess(fid);
-  replacer_->SetEvictable(fid, false);
-  ++pages_[fid].pin_count_;
+  replacer_->RecordAccess(fid, AccessType::Unknown, PageKey(file_id, pid));
+  tracer_.Record(pid, AccessType::Unknown, TraceEvent::Miss, file_id);
   return &pages_[fid];
 }
 
-auto BufferPoolManager::FetchPage(page_id_t page_id) -> Page * {
-  auto it = page_table_.find(page_id);
-  if (it != page_table_.end()) {
-    auto fid = it->second;
-    auto &frame = pages_[fid];
-    ++frame.pin_count_;
-    replacer_->RecordAccess(fid);
-    replacer_->SetEvictable(fid, false);
-    return &frame;
+auto BufferPoolManager::FetchPage(page_id_t page_id, AccessType access_type, file_id_t file_id) -> Page * {
+  std::unique_lock lock(latch_);
+  return FetchPageLocked(page_id, file_id, access_type, lock);
+}
+
+auto BufferPoolManager::PinFrame(frame_id_t frame_id, AccessType access_type, std::unique_lock<std::mutex> &lock)
+    -> bool {
+  auto &frame = pages_[frame_id];
+  ++frame.pin_count_;
+  frame.evicting_ = false;
+  if (frame.io_pending_) {
+    io_cv_.wait(lock, [&] { return !frame.io_pending_; });
+    // Our pin keeps the frame from being reused, so an invalid page id means that the read failed.
+    if (frame.page_id_ == INVALID_PAGE_ID) {
+      DropFailedRead(frame_id);
+      return false;
+    }
   }
-  // Not found in buffer pool. Read from the disk.
+  RecordHit(frame_id, access_type);
+  hits_.Add();
+  ++thread_fetches_;
+  tracer_.Record(frame.page_id_, access_type, TraceEvent::Hit, frame.file_id_);
+  return true;
+}
+
+void BufferPoolManager::DropFailedRead(frame_id_t frame_id) {
+  auto &frame = pages_[frame_id];
+  if (frame.page_id_ != INVALID_PAGE_ID) {
+    DropPage(frame_id);
+  }
+  if (--frame.pin_count_ == 0) {
+    replacer_->Remove(frame_id);
+    free_list_.push_back(frame_id);
+    WakeFrameWaiters();
+  }
+}
+
+void BufferPoolManager::RecordHit(frame_id_t frame_id, AccessType access_type) {
+  if (access_buffer_.Record(frame_id, access_type)) {
+    DrainAccesses();
+  }
+}
+
+void BufferPoolManager::DrainAccesses() {
+  access_buffer_.Drain([this](frame_id_t fid, AccessType access_type) {
+    auto &frame = pages_[fid];
+    // The frame may have been freed since the hit, it is tracked again once it is reused.
+    if (frame.page_id_ == INVALID_PAGE_ID) {
+      return;
+    }
+    // Like a fetch, a hit during a background write-back keeps the frame.
+    frame.evicting_ = false;
+    replacer_->RecordAccess(fid, access_type, PageKey(frame.file_id_, frame.page_id_));
+  });
+}
+
+auto BufferPoolManager::FetchPageLocked(page_id_t page_id, file_id_t file_id, AccessType access_type,
+                                        std::unique_lock<std::mutex> &lock) -> Page * {
   frame_id_t fid;
-  if (!free_list_.empty()) {
-    fid = free_list_.front();
-    free_list_.pop_front();
-  } else {
-    if (replacer_->Evict(&fid)) {
-      if (pages_[fid].IsDirty()) {
-        disk_manager_->WritePage(pages_[fid].page_id_, pages_[fid].GetData());
-        pages_[fid].is_dirty_ = false;
+  while (true) {
+    auto it = page_table_.find(PageKey(file_id, page_id));
+    if (it != page_table_.end()) {
+      fid = it->second;
+      if (PinFrame(fid, access_type, lock)) {
+        return &pages_[fid];
       }
-      page_table_.erase(page_table_.find(pages_[fid].page_id_));
-    } else {
+      // The prefetcher failed to read the page, try it ourselves.
+      continue;
+    }
+    // Not found in buffer pool. Read from the disk.
+    bool waited;
+    if (!WaitForFrame(&fid, file_id, lock, &waited)) {
+      fetch_failures_.Add();
       return nullptr;
     }
+    if (!waited || page_table_.find(PageKey(file_id, page_id)) == page_table_.end()) {
+      break;
+    }
+    // Somebody else read the page while we waited, hand the frame back and take theirs.
+    free_list_.push_back(fid);
+    WakeFrameWaiters();
   }
+  misses_.Add();
+  ++thread_fetches_;
   auto &frame = pages_[fid];
 
-  frame.page_id_ = page_id;
-  frame.pin_count_ = 1;
+  InstallPage(fid, page_id, file_id);
   frame.is_dirty_ = false;
+  frame.pin_count_ = 1;
 
-  page_table_[page_id] = fid;
-  disk_manager_->ReadPage(page_id, frame.GetData());
-  replacer_->RecordAccess(fid);
-  replacer_->SetEvictable(fid, false);
+  // Only the end of the file reads as zeros. A page that failed to read must not be installed, a write-back of it
+  // would overwrite the real page on disk.
+  if (!files_[file_id]->ReadPage(page_id, frame.GetData())) {
+    DropFailedRead(fid);
+    fetch_failures_.Add();
+    return nullptr;
+  }
+  replacer_->RecordAccess(fid, access_type, PageKey(file_id, page_id));
+  tracer_.Record(page_id, access_type, TraceEvent::Miss, file_id);
   return &frame;
 }
 
-auto BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) -> bool {
-  auto it = page_table_.find(page_id);
-  if (it == page_table_.end() || pages_[it->second].pin_count_ == 0) {
-    return false;
-  }
-  auto fid = it->second;
-  auto &frame = pages_[fid];
-  --frame.pin_count_;
-  if (frame.pin_count_ == 0) {
-    replacer_->SetEvictable(fid, true);
+auto BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty, file_id_t file_id) -> bool {
+  Page *page;
+  {
+    std::scoped_lock lock(latch_);
+    auto it = page_table_.find(PageKey(file_id, page_id));
+    if (it == page_table_.end() || pages_[it->second].pin_count_ <= 0) {
+      return false;
+    }
+    page = &pages_[it->second];
   }
+  UnpinFrame(page, is_dirty);
+  return true;
+}
+
+void BufferPoolManager::UnpinFrame(Page *page, bool is_dirty) {
+  // Mark the page dirty before giving up the pin, so that it cannot be evicted clean in between.
   if (is_dirty) {
-    frame.is_dirty_ = true;
+    SetDirty(*page);
+    if (flusher_running_.load(std::memory_order_relaxed) &&
+        dirty_count_.load(std::memory_order_relaxed) > flusher_dirty_target_.load(std::memory_order_relaxed) &&
+        !flusher_kicked_.exchange(true)) {
+      flusher_cv_.notify_one();
+    }
+  }
+  // Sequentially consistent with the announcement of a waiter in WaitForFrame(), so one of the two sees the other.
+  if (page->pin_count_.fetch_sub(1, std::memory_order_seq_cst) == 1) {
+    NotifyUnpinned();
   }
-  return true;
 }
 
-auto BufferPoolManager::FlushPage(page_id_t page_id) -> bool {
+auto BufferPoolManager::FlushPage(page_id_t page_id, file_id_t file_id) -> bool {
   if (page_id == INVALID_PAGE_ID) {
     return false;
   }
-  auto it = page_table_.find(page_id);
+  std::scoped_lock lock(latch_);
+  auto it = page_table_.find(PageKey(file_id, page_id));
   if (it == page_table_.end()) {
     return false;
   }
   auto fid = it->second;
   auto &frame = pages_[fid];
-  disk_manager_->WritePage(page_id, frame.GetData());
-  frame.is_dirty_ = false;
+  if (frame.io_pending_) {
+    return true;
+  }
+  if (!WriteFrame(frame)) {
+    return false;
+  }
+  SetClean(frame);
   return true;
 }
 
 void BufferPoolManager::FlushAllPages() {
+  std::scoped_lock lock(latch_);
+  // Frames with swizzled children are written from an unswizzled copy, the rest straight from the frame.
+  size_t swizzled = 0;
+  for (auto &pr : page_table_) {
+    auto &frame = pages_[pr.second];
+    swizzled += !frame.io_pending_ && frame.IsDirty() && frame.swizzle_head_ != -1;
+  }
+  auto *copies =
+      static_cast<char *>(std::aligned_alloc(FRAME_ALIGNMENT, std::max<size_t>(swizzled, 1) * BUSTUB_PAGE_SIZE));
+  vector<pair<uint64_t, const char *>> dirty;
+  vector<frame_id_t> frames;
+  swizzled = 0;
   for (auto &pr : page_table_) {
-    FlushPage(pr.first);
+    auto &frame = pages_[pr.second];
+    if (frame.io_pending_ || !frame.IsDirty()) {
+      continue;
+    }
+    const char *data = frame.GetData();
+    if (frame.swizzle_head_ != -1) {
+      auto *copy = copies + swizzled++ * BUSTUB_PAGE_SIZE;
+      CopyUnswizzled(frame, copy);
+      data = copy;
+    }
+    dirty.push_back({pr.first, data});
+    frames.push_back(pr.second);
+    SetClean(frame);
+  }
+  if (!WriteSorted(&dirty)) {
+    // latch_ is still held, so the frames hold the same pages. Which of them failed is not known, all are rewritten.
+    for (size_t i = 0; i < frames.size(); ++i) {
+      SetDirty(pages_[frames[i]]);
+    }
   }
+  std::free(copies);
 }
 
-auto BufferPoolManager::DeletePage(page_id_t page_id) -> bool {
+auto BufferPoolManager::DeletePage(page_id_t page_id, file_id_t file_id) -> bool {
   if (page_id == INVALID_PAGE_ID) {
     return false;
   }
-  auto it = page_table_.find(page_id);
+  std::scoped_lock lock(latch_);
+  auto it = page_table_.find(PageKey(file_id, page_id));
   if (it == page_table_.end()) {
+    files_[file_id]->DeallocatePage(page_id);
+    deleted_pages_.Add();
+    tracer_.Record(page_id, AccessType::Unknown, TraceEvent::Delete, file_id);
     return true;
   }
   auto fid = it->second;
   auto &frame = pages_[fid];
-  if (frame.GetPinCount() > 0) {
+  if (!Claim(frame)) {
     return false;
   }
   if (frame.IsDirty()) {
-    disk_manager_->WritePage(page_id, frame.GetData());
-    frame.is_dirty_ = false;
+    WriteFrame(frame);
+    SetClean(frame);
   }
-  page_table_.erase(it);
+  DropPage(fid);
   replacer_->Remove(fid);
   free_list_.push_back(fid);
+  WakeFrameWaiters();
   //  frame.ResetMemory();
-  frame.pin_count_ = 0;
-  frame.page_id_ = INVALID_PAGE_ID;
   frame.is_dirty_ = false;
-  disk_manager_->DeallocatePage(page_id);
-  // latch_.unlock();
+  files_[file_id]->DeallocatePage(page_id);
+  deleted_pages_.Add();
+  tracer_.Record(page_id, AccessType::Unknown, TraceEvent::Delete, file_id);
+  return true;
+}
+
+void BufferPoolManager::ReleaseResident(Page *page) {
+  if (page->pin_count_.fetch_sub(1, std::memory_order_seq_cst) == 1) {
+    NotifyUnpinned();
+  }
+}
+
+void BufferPoolManager::MarkDirty(Page *page) {
+  std::scoped_lock lock(latch_);
+  // The page may have been deleted while a resident guard still referred to it.
+  if (page->page_id_ != INVALID_PAGE_ID) {
+    SetDirty(*page);
+  }
+}
+
+void BufferPoolManager::EnableSwizzling(bool enable) {
+  std::scoped_lock lock(latch_);
+  swizzling_ = enable;
+  if (!enable) {
+    for (size_t i = 0; i < pool_size_; ++i) {
+      if (pages_[i].swizzle_parent_ != -1) {
+        UnswizzleChild(static_cast<frame_id_t>(i));
+      }
+    }
+  }
+}
+
+auto BufferPoolManager::FetchChild(const page_id_t *ref, AccessType access_type) -> Page * {
+  if (auto ref_value = LoadRef(ref); IsSwizzled(ref_value)) {
+    // Fast path: pin the child without latch_. Evicting or deleting the child claims its frame, which makes
+    // TryPin() fail from then on, and only restores the reference afterwards in DropPage(). The frame stays claimed
+    // until it is handed a new page, so once pinned it still holds the child if the reference is still tagged.
+    auto &frame = pages_[-ref_value - 2];
+    if (TryPin(frame)) {
+      if (LoadRef(ref) == ref_value) {
+        if (access_buffer_.Record(-ref_value - 2, access_type)) {
+          // Somebody else holding latch_ drains the buffer soon enough if we cannot.
+          if (std::unique_lock lock(latch_, std::try_to_lock); lock.owns_lock()) {
+            DrainAccesses();
+          }
+        }
+        swizzled_hits_.Add();
+        hits_.Add();
+        ++thread_fetches_;
+        tracer_.Record(frame.page_id_, access_type, TraceEvent::Hit, frame.file_id_);
+        return &frame;
+      }
+      UnpinFrame(&frame, false);
+    }
+  }
+  std::unique_lock lock(latch_);
+  auto ref_value = LoadRef(ref);
+  if (IsSwizzled(ref_value)) {
+    auto fid = -ref_value - 2;
+    // A child is swizzled once it has been read, so the pin cannot fail.
+    PinFrame(fid, access_type, lock);
+    swizzled_hits_.Add();
+    return &pages_[fid];
+  }
+  auto *page = FetchPageLocked(ref_value, pages_[FrameOf(ref)].file_id_, access_type, lock);
+  // The parent is pinned by the caller, so neither the miss nor a wait for a prefetch can have evicted it.
+  if (page != nullptr && swizzling_ && page->swizzle_parent_ == -1) {
+    auto fid = static_cast<frame_id_t>(page - pages_);
+    auto parent_fid = FrameOf(ref);
+    auto &parent = pages_[parent_fid];
+    page->swizzle_parent_ = parent_fid;
+    page->swizzle_offset_ = static_cast<uint32_t>(reinterpret_cast<const char *>(ref) - parent.data_);
+    page->swizzle_prev_ = -1;
+    page->swizzle_next_ = parent.swizzle_head_;
+    if (parent.swizzle_head_ != -1) {
+      pages_[parent.swizzle_head_].swizzle_prev_ = fid;
+    }
+    parent.swizzle_head_ = fid;
+    // Swizzling only changes the in-memory representation, so the parent is not dirtied.
+    StoreRef(ref, -fid - 2);
+  }
+  return page;
+}
+
+void BufferPoolManager::Unswizzle(const void *page_data) {
+  std::scoped_lock lock(latch_);
+  auto &frame = pages_[FrameOf(page_data)];
+  while (frame.swizzle_head_ != -1) {
+    UnswizzleChild(frame.swizzle_head_);
+  }
+}
+
+void BufferPoolManager::UnswizzleChild(frame_id_t frame_id) {
+  auto &child = pages_[frame_id];
+  auto &parent = pages_[child.swizzle_parent_];
+  StoreRef(reinterpret_cast<page_id_t *>(parent.data_ + child.swizzle_offset_), child.page_id_);
+  if (child.swizzle_prev_ != -1) {
+    pages_[child.swizzle_prev_].swizzle_next_ = child.swizzle_next_;
+  } else {
+    parent.swizzle_head_ = child.swizzle_next_;
+  }
+  if (child.swizzle_next_ != -1) {
+    pages_[child.swizzle_next_].swizzle_prev_ = child.swizzle_prev_;
+  }
+  child.swizzle_parent_ = child.swizzle_prev_ = child.swizzle_next_ = -1;
+}
+
+void BufferPoolManager::UnswizzleFrame(frame_id_t frame_id) {
+  auto &frame = pages_[frame_id];
+  while (frame.swizzle_head_ != -1) {
+    UnswizzleChild(frame.swizzle_head_);
+  }
+  if (frame.swizzle_parent_ != -1) {
+    UnswizzleChild(frame_id);
+  }
+}
+
+void BufferPoolManager::CopyUnswizzled(const Page &frame, char *buffer) const {
+  memcpy(buffer, frame.data_, BUSTUB_PAGE_SIZE);
+  for (auto fid = frame.swizzle_head_; fid != -1; fid = pages_[fid].swizzle_next_) {
+    memcpy(buffer + pages_[fid].swizzle_offset_, &pages_[fid].page_id_, sizeof(page_id_t));
+  }
+}
+
+auto BufferPoolManager::WriteFrame(Page &frame) -> bool {
+  if (frame.swizzle_head_ == -1) {
+    return files_[frame.file_id_]->WritePage(frame.page_id_, frame.GetData());
+  }
+  CopyUnswizzled(frame, io_buffer_);
+  return files_[frame.file_id_]->WritePage(frame.page_id_, io_buffer_);
+}
+
+void BufferPoolManager::StartFlusher(double dirty_ratio, size_t batch_size, std::chrono::milliseconds interval) {
+  StopFlusher();
+  std::scoped_lock lock(latch_);
+  flusher_dirty_ratio_ = dirty_ratio;
+  UpdateBackgroundTargets();
+  flusher_batch_size_ = batch_size;
+  flusher_interval_ = interval;
+  flusher_stop_ = false;
+  flusher_kicked_ = false;
+  flusher_running_ = true;
+  flusher_ = std::thread(&BufferPoolManager::FlusherLoop, this);
+}
+
+void BufferPoolManager::StopFlusher() {
+  {
+    std::scoped_lock lock(latch_);
+    if (!flusher_running_) {
+      return;
+    }
+    flusher_stop_ = true;
+    flusher_cv_.notify_one();
+  }
+  flusher_.join();
+  std::scoped_lock lock(latch_);
+  flusher_running_ = false;
+}
+
+void BufferPoolManager::FlusherLoop() {
+  auto *buffer = static_cast<char *>(std::aligned_alloc(FRAME_ALIGNMENT, WRITE_RUN_PAGES * BUSTUB_PAGE_SIZE));
+  vector<frame_id_t> batch;
+  vector<pair<uint64_t, const char *>> pages;
+  std::unique_lock lock(latch_);
+  while (!flusher_stop_) {
+    size_t flushed = 0;
+    for (size_t scanned = 0; scanned < pool_size_ && flushed < flusher_batch_size_;) {
+      // Pin, mark clean and copy up to WRITE_RUN_PAGES dirty frames, then write them back sorted without latch_.
+      // Pinning keeps a frame from being evicted and reread before its write lands, and a concurrent writer simply
+      // marks it dirty again.
+      for (; scanned < pool_size_ && batch.size() < WRITE_RUN_PAGES && flushed + batch.size() < flusher_batch_size_ &&
+             dirty_count_ > flusher_dirty_target_;
+           ++scanned) {
+        auto fid = static_cast<frame_id_t>(flush_hand_);
+        flush_hand_ = (flush_hand_ + 1) % pool_size_;
+        auto &frame = pages_[fid];
+        if (frame.page_id_ == INVALID_PAGE_ID || !frame.is_dirty_ || frame.pin_count_ > 0) {
+          continue;
+        }
+        ++frame.pin_count_;
+        SetClean(frame);
+        auto *copy = buffer + batch.size() * BUSTUB_PAGE_SIZE;
+        CopyUnswizzled(frame, copy);
+        pages.push_back({PageKey(frame.file_id_, frame.page_id_), copy});
+        batch.push_back(fid);
+      }
+      if (batch.empty()) {
+        break;
+      }
+      lock.unlock();
+      bool written = WriteSorted(&pages);
+      lock.lock();
+      for (size_t i = 0; i < batch.size(); ++i) {
+        if (!written) {
+          SetDirty(pages_[batch[i]]);
+        }
+        --pages_[batch[i]].pin_count_;
+      }
+      WakeFrameWaiters();
+      flushed += written ? batch.size() : 0;
+      batch.clear();
+      pages.clear();
+      if (!written) {
+        // Retry at the next wake up rather than spin on a failing disk.
+        break;
+      }
+    }
+    flushed_pages_.Add(flushed);
+    if (flushed < flusher_batch_size_) {
+      // Either under the target or every dirty frame is pinned, sleep until kicked.
+      flusher_kicked_ = false;
+      flusher_cv_.wait_for(lock, flusher_interval_, [&] { return flusher_stop_ || flusher_kicked_; });
+    }
+  }
+  lock.unlock();
+  std::free(buffer);
+}
+
+void BufferPoolManager::StartEvictor(double low_watermark, double high_watermark) {
+  StopEvictor();
+  std::scoped_lock lock(latch_);
+  evictor_low_ratio_ = low_watermark;
+  evictor_high_ratio_ = high_watermark;
+  UpdateBackgroundTargets();
+  evictor_stop_ = false;
+  evictor_kicked_ = true;
+  evictor_running_ = true;
+  evictor_ = std::thread(&BufferPoolManager::EvictorLoop, this);
+}
+
+void BufferPoolManager::StopEvictor() {
+  {
+    std::scoped_lock lock(latch_);
+    if (!evictor_running_) {
+      return;
+    }
+    evictor_stop_ = true;
+    evictor_cv_.notify_one();
+  }
+  evictor_.join();
+  std::scoped_lock lock(latch_);
+  evictor_running_ = false;
+}
+
+void BufferPoolManager::UpdateBackgroundTargets() {
+  auto frames = static_cast<double>(pool_size_);
+  flusher_dirty_target_ = static_cast<size_t>(flusher_dirty_ratio_ * frames);
+  evictor_low_watermark_ = static_cast<size_t>(evictor_low_ratio_ * frames);
+  evictor_high_watermark_ = std::max(evictor_low_watermark_, static_cast<size_t>(evictor_high_ratio_ * frames));
+}
+
+void BufferPoolManager::EvictorLoop() {
+  auto *buffer = static_cast<char *>(std::aligned_alloc(FRAME_ALIGNMENT, BUSTUB_PAGE_SIZE));
+  std::unique_lock lock(latch_);
+  while (!evictor_stop_) {
+    evictor_cv_.wait(lock, [&] { return evictor_stop_ || evictor_kicked_; });
+    evictor_kicked_ = false;
+    while (!evictor_stop_ && free_list_.size() < evictor_high_watermark_) {
+      frame_id_t fid;
+      if (!EvictFrame(&fid)) {
+        // Everything is pinned, wait for the next kick.
+        break;
+      }
+      auto &frame = pages_[fid];
+      if (frame.IsDirty()) {
+        // The frame stays in the page table while it is written back, so a fetch in the meantime still hits it.
+        // Such a fetch clears evicting_ and puts the frame back in the replacer, and we give it up. A TryPin() in
+        // the meantime only makes the claim below fail.
+        auto page_id = frame.page_id_;
+        auto *file = files_[frame.file_id_];
+        frame.pin_count_ = 1;
+        frame.evicting_ = true;
+        SetClean(frame);
+        CopyUnswizzled(frame, buffer);
+        lock.unlock();
+        bool written = file->WritePage(page_id, buffer);
+        lock.lock();
+        --frame.pin_count_;
+        if (!written) {
+          // Keep the page dirty, and tracked unless a fetch already did so, and wait for the next kick.
+          SetDirty(frame);
+          if (frame.evicting_) {
+            frame.evicting_ = false;
+            replacer_->RecordAccess(fid);
+          }
+          WakeFrameWaiters();
+          break;
+        }
+        if (!frame.evicting_) {
+          WakeFrameWaiters();
+          continue;
+        }
+        frame.evicting_ = false;
+        if (!Claim(frame)) {
+          // Tracked again without the page id, see EvictFrame().
+          replacer_->RecordAccess(fid);
+          continue;
+        }
+      }
+      DropPage(fid);
+      free_list_.push_back(fid);
+      WakeFrameWaiters();
+      background_evictions_.Add();
+      // Let the foreground in between victims.
+      lock.unlock();
+      lock.lock();
+    }
+  }
+  lock.unlock();
+  std::free(buffer);
+}
+
+auto BufferPoolManager::Resize(size_t pool_size, std::chrono::milliseconds timeout) -> bool {
+  std::scoped_lock resize_lock(resize_latch_);
+  if (pool_size == 0 || pool_size > max_pool_size_) {
+    return false;
+  }
+  std::unique_lock lock(latch_);
+  if (pool_size >= pool_size_) {
+    return GrowFrames(pool_size);
+  }
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (pool_size_ > pool_size) {
+    size_t low = pool_size_ - std::min<size_t>(pool_size_ - pool_size, RESIZE_CHUNK_SIZE);
+    if (!ReleaseFrames(low, lock, deadline)) {
+      return false;
+    }
+    // Let the foreground in between chunks.
+    lock.unlock();
+    lock.lock();
+  }
+  return true;
+}
+
+void BufferPoolManager::MapArena() {
+  arena_size_ = ArenaBytes(max_pool_size_);
+  auto *reserved = static_cast<char *>(mmap(nullptr, arena_size_ + HUGE_PAGE_SIZE, PROT_NONE,
+                                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+  auto offset = (HUGE_PAGE_SIZE - reinterpret_cast<uintptr_t>(reserved) % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+  if (offset != 0) {
+    munmap(reserved, offset);
+  }
+  munmap(reserved + offset + arena_size_, HUGE_PAGE_SIZE - offset);
+  frame_arena_ = reserved + offset;
+  madvise(frame_arena_, arena_size_, MADV_HUGEPAGE);
+}
+
+auto BufferPoolManager::CommitArena(size_t begin, size_t end) -> bool {
+  char *address = frame_arena_ + begin;
+  size_t length = end - begin;
+  if (hugetlb_arena_) {
+    // Without MAP_NORESERVE the huge pages are set aside by the mmap itself, which fails right away instead of on
+    // first touch if there are not enough of them.
+    if (mmap(address, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_FIXED, -1, 0) !=
+        MAP_FAILED) {
+      return true;
+    }
+    // The failed mmap may have dropped the reservation of the range, so it is reserved again.
+    hugetlb_arena_ = false;
+    DecommitArena(begin, end);
+  }
+  return mprotect(address, length, PROT_READ | PROT_WRITE) == 0;
+}
+
+void BufferPoolManager::DecommitArena(size_t begin, size_t end) {
+  // Mapping fresh address space over the range frees its pages, explicit huge pages included.
+  mmap(frame_arena_ + begin, end - begin, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+  madvise(frame_arena_ + begin, end - begin, MADV_HUGEPAGE);
+}
+
+auto BufferPoolManager::GrowFrames(size_t pool_size) -> bool {
+  size_t old_size = pool_size_;
+  // Memory is committed in whole huge pages, a transparent huge page is only split when part of it is released again.
+  if (ArenaBytes(pool_size) > ArenaBytes(old_size) && !CommitArena(ArenaBytes(old_size), ArenaBytes(pool_size))) {
+    return false;
+  }
+  for (; constructed_frames_ < pool_size; ++constructed_frames_) {
+    new (&pages_[constructed_frames_]) Page();
+  }
+  replacer_->SetCapacity(pool_size);
+  for (size_t i = old_size; i < pool_size; ++i) {
+    pages_[i].data_ = frame_arena_ + i * BUSTUB_PAGE_SIZE;
+    pages_[i].pin_count_ = -1;  // free frames stay claimed, see Claim()
+    free_list_.push_back(static_cast<frame_id_t>(i));
+  }
+  pool_size_ = pool_size;
+  UpdateBackgroundTargets();
+  WakeFrameWaiters();
   return true;
 }
 
-auto BufferPoolManager::FetchPageBasic(page_id_t page_id) -> BasicPageGuard { return {this, FetchPage(page_id)}; }
+auto BufferPoolManager::ReleaseFrames(size_t low, std::unique_lock<std::mutex> &lock,
+                                      std::chrono::steady_clock::time_point deadline) -> bool {
+  size_t high = pool_size_;
+  vector<bool> released;
+  for (size_t i = low; i < high; ++i) {
+    released.push_back(false);
+  }
+  size_t remaining = high - low;
+  while (true) {
+    // Free frames are ours as they are, the others are emptied like DeletePage() does once nobody pins them.
+    for (auto it = free_list_.begin(); it != free_list_.end();) {
+      if (static_cast<size_t>(*it) >= low) {
+        released[*it - low] = true;
+        --remaining;
+        it = free_list_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    for (size_t i = low; i < high; ++i) {
+      auto fid = static_cast<frame_id_t>(i);
+      auto &frame = pages_[fid];
+      if (released[i - low] || frame.page_id_ == INVALID_PAGE_ID || !Claim(frame)) {
+        continue;
+      }
+      if (frame.IsDirty()) {
+        if (!WriteFrame(frame)) {
+          // Kept like a pinned frame, until the deadline.
+          frame.pin_count_ = 0;
+          continue;
+        }
+        SetClean(frame);
+      }
+      DropPage(fid);
+      replacer_->Remove(fid);
+      released[i - low] = true;
+      --remaining;
+    }
+    if (remaining == 0) {
+      break;
+    }
+    if (std::chrono::steady_clock::now() >= deadline) {
+      for (size_t i = low; i < high; ++i) {
+        if (released[i - low]) {
+          free_list_.push_back(static_cast<frame_id_t>(i));
+        }
+      }
+      WakeFrameWaiters();
+      return false;
+    }
+    // Some frames are pinned, or in the middle of a write-back or a prefetch read.
+    lock.unlock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    lock.lock();
+  }
+  pool_size_ = low;
+  replacer_->SetCapacity(low);
+  UpdateBackgroundTargets();
+  // An explicit huge page is given back only as a whole, transparent ones may be split to release the frames alone.
+  if (!hugetlb_arena_) {
+    madvise(frame_arena_ + low * BUSTUB_PAGE_SIZE, (high - low) * BUSTUB_PAGE_SIZE, MADV_DONTNEED);
+  }
+  if (ArenaBytes(high) > ArenaBytes(low)) {
+    DecommitArena(ArenaBytes(low), ArenaBytes(high));
+  }
+  return true;
+}
 
-auto BufferPoolManager::FetchPageRead(page_id_t page_id) -> ReadPageGuard {
-  Page *page = FetchPage(page_id);
+void BufferPoolManager::Prefetch(page_id_t page_id, AccessType access_type, file_id_t file_id) {
+  size_t max_queued;
+  {
+    std::scoped_lock lock(latch_);
+    if (prefetcher_stop_ || page_table_.find(PageKey(file_id, page_id)) != page_table_.end()) {
+      return;
+    }
+    StartPrefetcher();
+    // Read under the latch, Resize() may change the pool size. A pool of fewer than 4 frames still queues one page.
+    max_queued = std::max<size_t>(1, pool_size_ / 4);
+  }
+  if (prefetch_queue_.size() < max_queued) {
+    prefetch_queue_.push({page_id, file_id, access_type});
+  }
+}
+
+void BufferPoolManager::StartPrefetcher() {
+  if (!prefetcher_running_) {
+    prefetcher_running_ = true;
+    prefetcher_ = std::thread(&BufferPoolManager::PrefetchLoop, this);
+  }
+}
+
+void BufferPoolManager::PrefetchLoop() {
+  PrefetchRequest request;
+  while (prefetch_queue_.pop_wait(request)) {
+    std::unique_lock lock(latch_);
+    if (prefetcher_stop_) {
+      break;
+    }
+    auto [page_id, file_id, access_type] = request;
+    frame_id_t fid;
+    if (page_table_.find(PageKey(file_id, page_id)) != page_table_.end() || !AcquireFrame(&fid, file_id)) {
+      continue;
+    }
+    // Publish the frame before reading so that concurrent fetches wait for this read instead of issuing another.
+    auto &frame = pages_[fid];
+    InstallPage(fid, page_id, file_id);
+    frame.pin_count_ = 1;
+    frame.is_dirty_ = false;
+    frame.io_pending_ = true;
+    lock.unlock();
+    bool read = files_[file_id]->ReadPage(page_id, frame.GetData());
+    lock.lock();
+    frame.io_pending_ = false;
+    if (!read) {
+      // Fetches waiting for the read find the page gone and read it themselves.
+      DropFailedRead(fid);
+      io_cv_.notify_all();
+      continue;
+    }
+    io_cv_.notify_all();
+    replacer_->RecordAccess(fid, access_type, PageKey(file_id, page_id));
+    --frame.pin_count_;
+    WakeFrameWaiters();
+    prefetched_pages_.Add();
+    tracer_.Record(page_id, access_type, TraceEvent::Prefetch, file_id);
+  }
+}
+
+auto BufferPoolManager::TryFetchPageRead(page_id_t page_id, AccessType access_type, file_id_t file_id)
+    -> ReadPageGuard {
+  std::scoped_lock lock(latch_);
+  auto it = page_table_.find(PageKey(file_id, page_id));
+  if (it == page_table_.end() || pages_[it->second].io_pending_) {
+    return {};
+  }
+  auto fid = it->second;
+  auto &frame = pages_[fid];
+  ++frame.pin_count_;
+  frame.evicting_ = false;
+  RecordHit(fid, access_type);
+  tracer_.Record(page_id, access_type, TraceEvent::Hit, file_id);
+  return {this, &frame};
+}
+
+auto BufferPoolManager::FetchPageBasic(page_id_t page_id, AccessType access_type, file_id_t file_id)
+    -> BasicPageGuard {
+  return {this, FetchPage(page_id, access_type, file_id)};
+}
+
+auto BufferPoolManager::FetchPageRead(page_id_t page_id, AccessType access_type, file_id_t file_id)
+    -> ReadPageGuard {
+  Page *page = FetchPage(page_id, access_type, file_id);
   return {this, page};
 }
 
-auto BufferPoolManager::FetchPageWrite(page_id_t page_id) -> WritePageGuard {
-  Page *page = FetchPage(page_id);
+auto BufferPoolManager::FetchPageWrite(page_id_t page_id, AccessType access_type, file_id_t file_id)
+    -> WritePageGuard {
+  Page *page = FetchPage(page_id, access_type, file_id);
   return {this, page};
 }
 
-auto BufferPoolManager::NewPageGuarded(page_id_t *page_id) -> BasicPageGuard { return {this, NewPage(page_id)}; }
+auto BufferPoolManager::FetchChildRead(const page_id_t *ref, AccessType access_type) -> ReadPageGuard {
+  return {this, FetchChild(ref, access_type)};
+}
+
+auto BufferPoolManager::FetchChildWrite(const page_id_t *ref, AccessType access_type) -> WritePageGuard {
+  return {this, FetchChild(ref, access_type)};
+}
+
+auto BufferPoolManager::NewPageGuarded(page_id_t *page_id, file_id_t file_id) -> BasicPageGuard {
+  return {this, NewPage(page_id, file_id)};
+}
+
+auto BufferPoolManager::GetStats() -> BufferPoolStats {
+  BufferPoolStats stats;
+  stats.pool_size_ = pool_size_;
+  stats.dirty_pages_ = dirty_count_.load(std::memory_order_relaxed);
+  stats.hits_ = hits_.Load();
+  stats.misses_ = misses_.Load();
+  stats.swizzled_hits_ = swizzled_hits_.Load();
+  stats.new_pages_ = new_pages_.Load();
+  stats.deleted_pages_ = deleted_pages_.Load();
+  stats.fetch_failures_ = fetch_failures_.Load();
+  stats.frame_waits_ = frame_waits_.Load();
+  stats.frame_wait_us_ = frame_wait_us_.Load();
+  stats.foreground_evictions_ = foreground_evictions_.Load();
+  stats.background_evictions_ = background_evictions_.Load();
+  stats.sync_write_backs_ = sync_write_backs_.Load();
+  stats.flushed_pages_ = flushed_pages_.Load();
+  stats.prefetched_pages_ = prefetched_pages_.Load();
+  std::scoped_lock lock(latch_);
+  for (size_t i = 0; i < file_count_; ++i) {
+    auto disk = files_[i]->GetStats();
+    stats.disk_.page_reads_ += disk.page_reads_;
+    stats.disk_.page_writes_ += disk.page_writes_;
+    stats.disk_.vectored_writes_ += disk.vectored_writes_;
+    stats.disk_.allocated_pages_ += disk.allocated_pages_;
+    stats.disk_.deallocated_pages_ += disk.deallocated_pages_;
+  }
+  stats.free_frames_ = free_list_.size();
+  stats.replacer_ = replacer_->GetStats();
+  return stats;
+}
+
+void BufferPoolStats::Dump(std::ostream &os) const {
+  os << "buffer pool: " << pool_size_ << " frames, " << free_frames_ << " free, " << dirty_pages_ << " dirty\n"
+     << "  hits " << hits_ << " (" << swizzled_hits_ << " swizzled), misses " << misses_ << ", hit ratio "
+     << HitRatio() << "\n"
+     << "  new pages " << new_pages_ << ", deleted pages " << deleted_pages_ << ", fetch failures " << fetch_failures_
+     << "\n"
+     << "  frame waits " << frame_waits_ << ", " << frame_wait_us_ << " us waiting\n"
+     << "  evictions " << foreground_evictions_ << " foreground, " << background_evictions_ << " background\n"
+     << "  write-backs " << sync_write_backs_ << " synchronous, " << flushed_pages_ << " by the flusher\n"
+     << "  prefetched pages " << prefetched_pages_ << "\n"
+     << "replacer: " << replacer_.evictions_ << " evictions, " << replacer_.failed_evictions_ << " failed, "
+     << replacer_.frames_scanned_ << " frames scanned\n"
+     << "disk: " << disk_.page_reads_ << " page reads, " << disk_.page_writes_ << " page writes ("
+     << disk_.vectored_writes_ << " vectored), " << disk_.allocated_pages_ << " pages allocated, "
+     << disk_.deallocated_pages_ << " deallocated\n";
+}
 
 }  // namespace CrazyDave
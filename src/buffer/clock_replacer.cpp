@@ -0,0 +1,97 @@
+#include "buffer/clock_replacer.h"
+
+namespace CrazyDave {
+
+ClockReplacer::ClockReplacer(size_t num_frames) {
+  entries_.reserve(num_frames);
+  for (size_t i = 0; i < num_frames; ++i) {
+    entries_.push_back({});
+  }
+}
+
+auto ClockReplacer::Evict(frame_id_t *frame_id, const std::function<auto(frame_id_t)->bool> &evictable) -> bool {
+  // Two rounds are enough: the first one clears every reference bit it passes.
+  for (size_t step = 0, n = entries_.size(); tracked_count_ > 0 && step < 2 * n; ++step) {
+    ++stats_.frames_scanned_;
+    auto fid = static_cast<frame_id_t>(hand_);
+    auto &entry = entries_[hand_];
+    hand_ = hand_ + 1 == n ? 0 : hand_ + 1;
+    if (!entry.tracked_ || (evictable ? !evictable(fid) : !entry.is_evictable_)) {
+      continue;
+    }
+    if (entry.referenced_) {
+      entry.referenced_ = false;
+      continue;
+    }
+    *frame_id = fid;
+    Remove(fid);
+    ++stats_.evictions_;
+    return true;
+  }
+  ++stats_.failed_evictions_;
+  return false;
+}
+
+void ClockReplacer::RecordAccess(frame_id_t frame_id, AccessType access_type, page_key_t /*page_key*/) {
+  auto &entry = entries_[frame_id];
+  if (!entry.tracked_) {
+    entry.tracked_ = true;
+    entry.referenced_ = false;
+    ++tracked_count_;
+    return;
+  }
+  if (access_type != AccessType::Scan) {
+    entry.referenced_ = true;
+  }
+}
+
+void ClockReplacer::SetEvictable(frame_id_t frame_id, bool set_evictable) {
+  auto &entry = entries_[frame_id];
+  if (entry.is_evictable_ != set_evictable) {
+    if (set_evictable) {
+      ++curr_size_;
+    } else {
+      --curr_size_;
+    }
+  }
+  entry.is_evictable_ = set_evictable;
+}
+
+void ClockReplacer::Remove(frame_id_t frame_id) {
+  auto &entry = entries_[frame_id];
+  if (!entry.tracked_) {
+    return;
+  }
+  if (entry.is_evictable_) {
+    --curr_size_;
+  }
+  entry = {};
+  --tracked_count_;
+}
+
+void ClockReplacer::SetCapacity(size_t num_frames) {
+  while (entries_.size() > num_frames) {
+    Remove(static_cast<frame_id_t>(entries_.size() - 1));
+    entries_.pop_back();
+  }
+  while (entries_.size() < num_frames) {
+    entries_.push_back({});
+  }
+  if (hand_ >= num_frames) {
+    hand_ = 0;
+  }
+}
+
+void ClockReplacer::GetHotFrames(vector<frame_id_t> *frames) {
+  // Referenced frames survive the next sweep, the others go in the order the hand reaches them, last ones first.
+  for (int referenced = 1; referenced >= 0; --referenced) {
+    for (size_t step = entries_.size(); step > 0; --step) {
+      auto fid = (hand_ + step - 1) % entries_.size();
+      if (entries_[fid].tracked_ && entries_[fid].referenced_ == static_cast<bool>(referenced)) {
+        frames->push_back(static_cast<frame_id_t>(fid));
+      }
+    }
+  }
+}
+
+}  // namespace CrazyDave
@@ -0,0 +1,141 @@
+#include "buffer/epoch_manager.h"
+#include <thread>
+
+namespace CrazyDave {
+
+EpochGuard::EpochGuard(EpochGuard &&that) noexcept : manager_(that.manager_), slot_(that.slot_) {
+  that.manager_ = nullptr;
+  that.slot_ = -1;
+}
+
+auto EpochGuard::operator=(EpochGuard &&that) noexcept -> EpochGuard & {
+  if (this != &that) {
+    Drop();
+    manager_ = that.manager_;
+    slot_ = that.slot_;
+    that.manager_ = nullptr;
+    that.slot_ = -1;
+  }
+  return *this;
+}
+
+EpochGuard::~EpochGuard() { Drop(); }
+
+void EpochGuard::Retire(page_id_t page_id, file_id_t file_id) {
+  // Stamp with the global epoch rather than the announced one: it may have advanced since, and a reader that
+  // announced the newer epoch before the page was unlinked can still reach it.
+  manager_->slots_[slot_].retired_.push_back(
+      {manager_->global_epoch_.load(std::memory_order_seq_cst), page_id, file_id, nullptr});
+}
+
+void EpochGuard::RetirePin(Page *page) {
+  // Same stamp as Retire(): a thread that announced a newer epoch may have read the frame pointer before it was
+  // cleared.
+  manager_->slots_[slot_].retired_.push_back(
+      {manager_->global_epoch_.load(std::memory_order_seq_cst), INVALID_PAGE_ID, 0, page});
+}
+
+void EpochGuard::Drop() {
+  if (manager_ != nullptr) {
+    manager_->Exit(slot_);
+    manager_ = nullptr;
+    slot_ = -1;
+  }
+}
+
+EpochManager::EpochManager(std::function<auto(page_id_t, file_id_t)->bool> reclaim, std::function<void(Page *)> unpin)
+    : reclaim_(std::move(reclaim)), unpin_(std::move(unpin)) {}
+
+auto EpochManager::Enter() -> EpochGuard {
+  int start = static_cast<int>(std::hash<std::thread::id>{}(std::this_thread::get_id()) % EPOCH_SLOTS);
+  int i = start;
+  while (true) {
+    bool expected = false;
+    if (!slots_[i].owned_.load(std::memory_order_relaxed) &&
+        slots_[i].owned_.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+      break;
+    }
+    i = (i + 1) % EPOCH_SLOTS;
+    if (i == start) {
+      std::this_thread::yield();
+    }
+  }
+  // Announce the epoch before reading anything from the structure. The fence orders the announcement before the
+  // reads, so a reclaimer either sees it or the reads see the pages unlinked by then.
+  slots_[i].epoch_.store(global_epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  return {this, i};
+}
+
+void EpochManager::Exit(int slot) {
+  auto &s = slots_[slot];
+  s.epoch_.store(INACTIVE, std::memory_order_release);
+  if (s.retired_.size() >= static_cast<size_t>(EPOCH_RECLAIM_BATCH)) {
+    TryAdvance();
+    Reclaim(s);
+  }
+  s.owned_.store(false, std::memory_order_release);
+}
+
+void EpochManager::TryAdvance() {
+  uint64_t epoch = global_epoch_.load(std::memory_order_seq_cst);
+  for (auto &slot : slots_) {
+    uint64_t announced = slot.epoch_.load(std::memory_order_seq_cst);
+    if (announced != INACTIVE && announced != epoch) {
+      return;
+    }
+  }
+  global_epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+}
+
+void EpochManager::Reclaim(Slot &slot) {
+  uint64_t oldest = global_epoch_.load(std::memory_order_seq_cst);
+  for (auto &s : slots_) {
+    uint64_t announced = s.epoch_.load(std::memory_order_seq_cst);
+    if (announced < oldest) {
+      oldest = announced;
+    }
+  }
+  size_t kept = 0;
+  for (size_t i = 0; i < slot.retired_.size(); ++i) {
+    auto entry = slot.retired_[i];
+    if (entry.epoch_ >= oldest || !Reclaim(entry)) {
+      slot.retired_[kept++] = entry;
+    }
+  }
+  while (slot.retired_.size() > kept) {
+    slot.retired_.pop_back();
+  }
+}
+
+auto EpochManager::Reclaim(const Retired &entry) -> bool {
+  if (entry.pin_ != nullptr) {
+    unpin_(entry.pin_);
+    return true;
+  }
+  return reclaim_(entry.page_id_, entry.file_id_);
+}
+
+void EpochManager::ReclaimAll() {
+  for (auto &slot : slots_) {
+    size_t kept = 0;
+    for (size_t i = 0; i < slot.retired_.size(); ++i) {
+      if (!Reclaim(slot.retired_[i])) {
+        slot.retired_[kept++] = slot.retired_[i];
+      }
+    }
+    while (slot.retired_.size() > kept) {
+      slot.retired_.pop_back();
+    }
+  }
+}
+
+auto EpochManager::GetRetiredCount() const -> size_t {
+  size_t count = 0;
+  for (auto &slot : slots_) {
+    count += slot.retired_.size();
+  }
+  return count;
+}
+
+}  // namespace CrazyDave
@@ -2,15 +2,23 @@
 
 namespace CrazyDave {
 
-LRUKReplacer::LRUKReplacer(size_t num_frames, size_t k) : replacer_size_(num_frames), k_(k) {}
+LRUKReplacer::LRUKReplacer(size_t num_frames, size_t k) : node_store_(num_frames), replacer_size_(num_frames), k_(k) {}
 
-auto LRUKReplacer::Evict(frame_id_t *frame_id) -> bool {
+auto LRUKReplacer::Evict(frame_id_t *frame_id, const std::function<auto(frame_id_t)->bool> &evictable) -> bool {
   // latch_.lock();
   size_t max_diff = 0;
   auto victim_it = node_store_.end();
+  auto scan_victim_it = node_store_.end();
   for (auto it = node_store_.begin(); it != node_store_.end(); ++it) {
     auto &node = it->second;
-    if (!node.is_evictable_) {
+    if (evictable ? !evictable(node.fid_) : !node.is_evictable_) {
+      continue;
+    }
+    if (node.is_scan_) {
+      if (scan_victim_it == node_store_.end() ||
+          node.history_.back() < scan_victim_it->second.history_.back()) {
+        scan_victim_it = it;
+      }
       continue;
     }
     if (max_diff != inf_) {
@@ -27,23 +35,38 @@ auto LRUKReplacer::Evict(frame_id_t *frame_id) -> bool {
       }
     }
   }
+  if (scan_victim_it != node_store_.end()) {
+    victim_it = scan_victim_it;
+  }
+  stats_.frames_scanned_ += node_store_.size();
   if (victim_it == node_store_.end()) {
+    ++stats_.failed_evictions_;
     // latch_.unlock();
     return false;
   }
+  ++stats_.evictions_;
   *frame_id = victim_it->second.fid_;
-  --curr_size_;
+  if (victim_it->second.is_evictable_) {
+    --curr_size_;
+  }
   node_store_.erase(victim_it);
   // latch_.unlock();
   return true;
 }
 
-void LRUKReplacer::RecordAccess(frame_id_t frame_id) {
+void LRUKReplacer::RecordAccess(frame_id_t frame_id, AccessType access_type, page_key_t /*page_key*/) {
   // latch_.lock();
   auto &node = node_store_[frame_id];
   if (node.history_.empty()) {
     node.fid_ = frame_id;
     node.k_ = k_;
+    node.is_scan_ = access_type == AccessType::Scan;
+  } else if (access_type == AccessType::Scan) {
+    if (!node.is_scan_) {
+      return;
+    }
+  } else {
+    node.is_scan_ = false;
   }
   node.history_.push_back(current_timestamp_);
   if (node.history_.size() > k_) {
@@ -74,8 +97,10 @@ void LRUKReplacer::Remove(frame_id_t frame_id) {
     // latch_.unlock();
     return;
   }
+  if (it->second.is_evictable_) {
+    --curr_size_;
+  }
   node_store_.erase(it);
-  --curr_size_;
   // latch_.unlock();
 }
 
@@ -86,4 +111,28 @@ auto LRUKReplacer::Size() -> size_t {
   return res;
 }
 
+void LRUKReplacer::SetCapacity(size_t num_frames) { replacer_size_ = num_frames; }
+
+void LRUKReplacer::GetHotFrames(vector<frame_id_t> *frames) {
+  // Frames with k accesses first, by their k-th most recent one like Evict() ranks them. Frames with fewer follow by
+  // their number of accesses and then their last one: Evict() takes them by their first access, which says little
+  // about how hot they are. Scanned frames come last. The class and access count go in the top bits of the rank.
+  vector<pair<size_t, frame_id_t>> ranked;
+  for (auto &[fid, node] : node_store_) {
+    size_t rank;
+    if (node.is_scan_) {
+      rank = node.history_.back();
+    } else if (node.history_.size() < k_) {
+      rank = size_t{1} << 62 | node.history_.size() << 48 | node.history_.back();
+    } else {
+      rank = size_t{2} << 62 | node.history_.front();
+    }
+    ranked.push_back({rank, fid});
+  }
+  ranked.sort([](const pair<size_t, frame_id_t> &a, const pair<size_t, frame_id_t> &b) { return a.first > b.first; });
+  for (size_t i = 0; i < ranked.size(); ++i) {
+    frames->push_back(ranked[i].second);
+  }
+}
+
 }  // namespace CrazyDave
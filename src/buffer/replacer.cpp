@@ -0,0 +1,20 @@
+#include "buffer/replacer.h"
+#include "buffer/arc_replacer.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+
+namespace CrazyDave {
+
+auto MakeReplacer(ReplacerType type, size_t num_frames, size_t k) -> Replacer * {
+  switch (type) {
+    case ReplacerType::Clock:
+      return new ClockReplacer{num_frames};
+    case ReplacerType::ARC:
+      return new ARCReplacer{num_frames};
+    case ReplacerType::LRUK:
+    default:
+      return new LRUKReplacer{num_frames, k};
+  }
+}
+
+}  // namespace CrazyDave
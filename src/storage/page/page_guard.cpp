@@ -4,20 +4,28 @@
 namespace CrazyDave {
 
 BasicPageGuard::BasicPageGuard(BasicPageGuard &&that) noexcept
-    : bpm_(that.bpm_), page_(that.page_), is_dirty_(that.is_dirty_) {
+    : bpm_(that.bpm_), page_(that.page_), is_dirty_(that.is_dirty_), resident_(that.resident_) {
   that.bpm_ = nullptr;
   that.page_ = nullptr;
   that.is_dirty_ = false;
+  that.resident_ = false;
 }
 
 void BasicPageGuard::Drop() {
   if (page_ == nullptr) {
     return;
   }
-  bpm_->UnpinPage(page_->GetPageId(), is_dirty_);
+  if (resident_) {
+    if (is_dirty_) {
+      bpm_->MarkDirty(page_);
+    }
+  } else {
+    bpm_->UnpinFrame(page_, is_dirty_);
+  }
   bpm_ = nullptr;
   page_ = nullptr;
   is_dirty_ = false;
+  resident_ = false;
 }
 
 auto BasicPageGuard::operator=(BasicPageGuard &&that) noexcept -> BasicPageGuard & {
@@ -27,10 +35,12 @@ auto BasicPageGuard::operator=(BasicPageGuard &&that) noexcept -> BasicPageGuard
   Drop();
   page_ = that.page_;
   is_dirty_ = that.is_dirty_;
+  resident_ = that.resident_;
   bpm_ = that.bpm_;
   that.bpm_ = nullptr;
   that.page_ = nullptr;
   that.is_dirty_ = false;
+  that.resident_ = false;
   return *this;
 }
 
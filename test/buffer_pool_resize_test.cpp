@@ -0,0 +1,63 @@
+#include <cstdio>
+#include <string>
+#include "check.h"
+#include "storage/index/b_plus_tree.h"
+
+// Shrinking and growing the buffer pool of a tree with resident levels on, the default, while it holds data.
+
+using Key = CrazyDave::String<65>;
+using Tree = CrazyDave::BPT<Key, int>;
+
+const char *const NAME = "buffer_pool_resize_test";
+const int NUM_KEYS = 50000;
+
+void RemoveFiles() {
+  for (const char *suffix : {"_dt", "_gb", "_hot"}) {
+    std::remove((std::string(NAME) + suffix).c_str());
+  }
+}
+
+void CheckKeys(Tree &tree, int count) {
+  CrazyDave::vector<int> result;
+  for (int i = 0; i < count; ++i) {
+    result.clear();
+    tree.find(Key("key" + std::to_string(i)), result);
+    CHECK(result.size() == 1 && result[0] == i);
+  }
+}
+
+auto PoolSize(Tree &tree) -> size_t { return tree.GetStats().pool_.pool_size_; }
+
+auto main() -> int {
+  RemoveFiles();
+  {
+    Tree tree(NAME, 0, 512, CrazyDave::LRUK_REPLACER_K);
+    for (int i = 0; i < NUM_KEYS; ++i) {
+      tree.insert(Key("key" + std::to_string(i)), i);
+    }
+    CheckKeys(tree, NUM_KEYS);
+
+    // The resident pages pin frames at the end of the pool too, shrinking must not wait for them.
+    CHECK(tree.ResizeBufferPool(64));
+    CHECK(PoolSize(tree) == 64);
+    CheckKeys(tree, NUM_KEYS);
+
+    CHECK(tree.ResizeBufferPool(1024));
+    CHECK(PoolSize(tree) == 1024);
+    for (int i = NUM_KEYS; i < 2 * NUM_KEYS; ++i) {
+      tree.insert(Key("key" + std::to_string(i)), i);
+    }
+    CheckKeys(tree, 2 * NUM_KEYS);
+
+    CHECK(tree.ResizeBufferPool(128));
+    CHECK(PoolSize(tree) == 128);
+    CheckKeys(tree, 2 * NUM_KEYS);
+  }
+  {
+    // Everything written back while shrinking is there after a reopen.
+    Tree tree(NAME, 0, 256, CrazyDave::LRUK_REPLACER_K);
+    CheckKeys(tree, 2 * NUM_KEYS);
+  }
+  RemoveFiles();
+  return 0;
+}
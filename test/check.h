@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+// Assertion of the behaviour tests, run by ctest: a failed check prints where it failed and fails the test.
+#define CHECK(condition)                                                                     \
+  do {                                                                                       \
+    if (!(condition)) {                                                                      \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+      std::exit(1);                                                                          \
+    }                                                                                        \
+  } while (false)
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include "data_structures/vector.h"
+#include "storage/disk/concurrent_queue.h"
+
+// Contention workload: producers push ITEMS_PER_PRODUCER values each, consumers pop until every value is consumed.
+// Every run checks that each value came out exactly once.
+const int QUEUE_CAPACITY = 1024;
+const int ITEMS_PER_PRODUCER = 1000000;
+const int BULK_SIZE = 16;
+
+class MutexQueue {
+ public:
+  auto push(const int &value) -> bool {
+    std::scoped_lock lock(latch_);
+    if (queue_.size() == QUEUE_CAPACITY) {
+      return false;
+    }
+    queue_.push_back(value);
+    return true;
+  }
+
+  auto pop(int &value) -> bool {
+    std::scoped_lock lock(latch_);
+    if (queue_.empty()) {
+      return false;
+    }
+    value = queue_.front();
+    queue_.pop_front();
+    return true;
+  }
+
+ private:
+  std::mutex latch_;
+  std::deque<int> queue_;
+};
+
+using LockFreeQueue = CrazyDave::ConcurrentQueue<int, QUEUE_CAPACITY>;
+
+// Spinning pushes and pops, one value at a time.
+template <class Queue>
+void Spin(Queue &queue, int producer, int total, std::atomic<int> &consumed, CrazyDave::vector<char> &seen,
+          bool is_producer) {
+  if (is_producer) {
+    for (int i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+      while (!queue.push(producer * ITEMS_PER_PRODUCER + i)) {
+        std::this_thread::yield();
+      }
+    }
+    return;
+  }
+  int value;
+  while (consumed.load(std::memory_order_relaxed) < total) {
+    if (queue.pop(value)) {
+      ++seen[value];
+      consumed.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+// Bulk pushes, and consumers sleeping on the queue until it is closed.
+void Blocking(LockFreeQueue &queue, int producer, int, std::atomic<int> &, CrazyDave::vector<char> &seen,
+              bool is_producer) {
+  int values[BULK_SIZE];
+  if (is_producer) {
+    for (int i = 0; i < ITEMS_PER_PRODUCER; i += BULK_SIZE) {
+      int n = std::min(BULK_SIZE, ITEMS_PER_PRODUCER - i);
+      for (int j = 0; j < n; ++j) {
+        values[j] = producer * ITEMS_PER_PRODUCER + i + j;
+      }
+      for (int pushed = 0; pushed < n;) {
+        size_t k = queue.push_bulk(values + pushed, n - pushed);
+        if (k == 0) {
+          queue.push_wait(values[pushed]);
+          k = 1;
+        }
+        pushed += static_cast<int>(k);
+      }
+    }
+    return;
+  }
+  while (size_t n = queue.pop_bulk_wait(values, BULK_SIZE)) {
+    for (size_t j = 0; j < n; ++j) {
+      ++seen[values[j]];
+    }
+  }
+}
+
+template <class Queue, class Worker>
+auto Run(const char *name, Worker worker, int producers, int consumers) -> bool {
+  Queue queue;
+  int total = producers * ITEMS_PER_PRODUCER;
+  std::atomic<int> consumed{0};
+  CrazyDave::vector<CrazyDave::vector<char>> seen;
+  for (int i = 0; i < consumers; ++i) {
+    CrazyDave::vector<char> counts;
+    counts.reserve(total);
+    for (int j = 0; j < total; ++j) {
+      counts.push_back(0);
+    }
+    seen.push_back(std::move(counts));
+  }
+  auto start = std::chrono::steady_clock::now();
+  CrazyDave::vector<std::thread> threads;
+  for (int i = 0; i < consumers; ++i) {
+    threads.push_back(std::thread([&, i] { worker(queue, 0, total, consumed, seen[i], false); }));
+  }
+  CrazyDave::vector<std::thread> producer_threads;
+  for (int i = 0; i < producers; ++i) {
+    producer_threads.push_back(std::thread([&, i] { worker(queue, i, total, consumed, seen[0], true); }));
+  }
+  for (auto &t : producer_threads) {
+    t.join();
+  }
+  if constexpr (std::is_same_v<Queue, LockFreeQueue>) {
+    queue.close();
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  for (int j = 0; j < total; ++j) {
+    int count = 0;
+    for (int i = 0; i < consumers; ++i) {
+      count += seen[i][j];
+    }
+    if (count != 1) {
+      std::cout << name << ": value " << j << " consumed " << count << " times\n";
+      return false;
+    }
+  }
+  std::cout << name << " " << producers << "p/" << consumers << "c: " << elapsed / total << " ns/item\n";
+  return true;
+}
+
+auto main() -> int {
+  const int configs[][2] = {{1, 1}, {2, 2}, {4, 4}, {1, 4}, {4, 1}};
+  bool ok = true;
+  for (auto [producers, consumers] : configs) {
+    ok &= Run<MutexQueue>("mutex queue   ", Spin<MutexQueue>, producers, consumers);
+    ok &= Run<LockFreeQueue>("lock-free spin", Spin<LockFreeQueue>, producers, consumers);
+    ok &= Run<LockFreeQueue>("lock-free wait", Blocking, producers, consumers);
+  }
+  return ok ? 0 : 1;
+}
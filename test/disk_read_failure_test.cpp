@@ -0,0 +1,46 @@
+#include <sys/stat.h>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include "buffer/buffer_pool_manager.h"
+#include "check.h"
+
+// Pages whose read fails are not taken for empty pages: the fetch fails and the frame goes back to the free list.
+// The data file is a directory, where every read fails.
+
+using CrazyDave::BufferPoolManager;
+
+const char *const NAME = "disk_read_failure_test";
+const size_t POOL_SIZE = 8;
+
+void RemoveFiles() {
+  for (const char *suffix : {"_dt", "_gb", "_hot"}) {
+    std::remove((std::string(NAME) + suffix).c_str());
+  }
+}
+
+auto main() -> int {
+  RemoveFiles();
+  CHECK(mkdir((std::string(NAME) + "_dt").c_str(), 0755) == 0);
+  {
+    BufferPoolManager bpm(NAME, POOL_SIZE);
+    bpm.SetFrameWaitTimeout(std::chrono::milliseconds(0));
+    for (int round = 0; round < 3; ++round) {
+      CHECK(bpm.FetchPage(0) == nullptr);
+      CHECK(bpm.GetStats().fetch_failures_ == static_cast<size_t>(round) + 1);
+      CHECK(bpm.GetStats().free_frames_ == POOL_SIZE);
+    }
+
+    // A failed prefetch leaves nothing behind either, and a fetch waiting for it fails the same way.
+    bpm.Prefetch(1);
+    CHECK(bpm.FetchPage(1) == nullptr);
+    for (int i = 0; i < 100 && bpm.GetStats().free_frames_ != POOL_SIZE; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(bpm.GetStats().free_frames_ == POOL_SIZE);
+    CHECK(bpm.GetStats().prefetched_pages_ == 0);
+  }
+  RemoveFiles();
+  return 0;
+}
@@ -0,0 +1,55 @@
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include "buffer/buffer_pool_manager.h"
+#include "check.h"
+
+// Pages whose write-back fails stay dirty in their frames instead of being lost. The data file is a link to
+// /dev/full, where every write fails with ENOSPC.
+
+using CrazyDave::BufferPoolManager;
+using CrazyDave::page_id_t;
+
+const char *const NAME = "disk_write_failure_test";
+const size_t POOL_SIZE = 8;
+
+void RemoveFiles() {
+  for (const char *suffix : {"_dt", "_gb", "_hot"}) {
+    std::remove((std::string(NAME) + suffix).c_str());
+  }
+}
+
+auto main() -> int {
+  RemoveFiles();
+  CHECK(symlink("/dev/full", (std::string(NAME) + "_dt").c_str()) == 0);
+  {
+    BufferPoolManager bpm(NAME, POOL_SIZE);
+    bpm.SetFrameWaitTimeout(std::chrono::milliseconds(0));
+    page_id_t page_ids[POOL_SIZE];
+    for (size_t i = 0; i < POOL_SIZE; ++i) {
+      auto *page = bpm.NewPage(&page_ids[i]);
+      CHECK(page != nullptr);
+      snprintf(page->GetData(), CrazyDave::BUSTUB_PAGE_SIZE, "page %zu", i);
+      CHECK(bpm.UnpinPage(page_ids[i], true));
+    }
+    CHECK(bpm.GetStats().dirty_pages_ == POOL_SIZE);
+
+    CHECK(!bpm.FlushPage(page_ids[0]));
+    bpm.FlushAllPages();
+    CHECK(bpm.GetStats().dirty_pages_ == POOL_SIZE);
+
+    // No victim can be written back, so no frame is given to a new page and every page keeps its data.
+    page_id_t page_id;
+    CHECK(bpm.NewPage(&page_id) == nullptr);
+    CHECK(bpm.GetStats().dirty_pages_ == POOL_SIZE);
+    for (size_t i = 0; i < POOL_SIZE; ++i) {
+      auto *page = bpm.FetchPage(page_ids[i]);
+      CHECK(page != nullptr);
+      CHECK(std::string(page->GetData()) == "page " + std::to_string(i));
+      CHECK(bpm.UnpinPage(page_ids[i], false));
+    }
+  }
+  RemoveFiles();
+  return 0;
+}
@@ -0,0 +1,60 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include "data_structures/flat_hashmap.h"
+#include "data_structures/linked_hashmap.h"
+#include "data_structures/vector.h"
+
+// Page table workload: a pool of POOL_SIZE frames over NUM_PAGES pages, every access looks the page up and a miss
+// evicts a random resident page to make room, like BufferPoolManager::FetchPage() does.
+const int POOL_SIZE = 4096;
+const int NUM_PAGES = 65536;
+const int NUM_ACCESSES = 4000000;
+
+template <class Map>
+auto RunPageTable(const char *name, const CrazyDave::vector<int> &trace) -> size_t {
+  Map page_table;
+  CrazyDave::vector<int> resident;
+  size_t hits = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < trace.size(); ++i) {
+    int page_id = trace[i];
+    auto it = page_table.find(page_id);
+    if (it != page_table.end()) {
+      hits += it->second >= 0;
+      continue;
+    }
+    int frame_id;
+    if (resident.size() < POOL_SIZE) {
+      frame_id = static_cast<int>(resident.size());
+      resident.push_back(page_id);
+    } else {
+      frame_id = static_cast<int>(static_cast<unsigned>(page_id) * 2654435761U % POOL_SIZE);
+      page_table.erase(page_table.find(resident[frame_id]));
+      resident[frame_id] = page_id;
+    }
+    page_table[page_id] = frame_id;
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  std::cout << name << ": " << elapsed / static_cast<double>(trace.size()) << " ns/access, " << hits << " hits\n";
+  return hits;
+}
+
+auto main() -> int {
+  std::mt19937 rng(42);
+  // Skewed accesses: 90% of them go to 10% of the pages.
+  std::uniform_int_distribution<int> hot(0, NUM_PAGES / 10 - 1);
+  std::uniform_int_distribution<int> cold(0, NUM_PAGES - 1);
+  std::uniform_int_distribution<int> coin(0, 9);
+  CrazyDave::vector<int> trace;
+  for (int i = 0; i < NUM_ACCESSES; ++i) {
+    trace.push_back(coin(rng) != 0 ? hot(rng) : cold(rng));
+  }
+  auto linked_hits = RunPageTable<CrazyDave::linked_hashmap<int, int>>("linked_hashmap", trace);
+  auto flat_hits = RunPageTable<CrazyDave::flat_hashmap<int, int>>("flat_hashmap  ", trace);
+  if (linked_hits != flat_hits) {
+    std::cout << "hit counts differ\n";
+    return 1;
+  }
+  return 0;
+}
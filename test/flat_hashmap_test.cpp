@@ -0,0 +1,64 @@
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "check.h"
+#include "data_structures/flat_hashmap.h"
+
+// Random inserts and erases on the flat hash map, checked against std::unordered_map, and the use of a map moved
+// from.
+
+using CrazyDave::flat_hashmap;
+
+void CheckSame(const flat_hashmap<int, std::string> &m, const std::unordered_map<int, std::string> &expected) {
+  CHECK(m.size() == expected.size());
+  size_t count = 0;
+  for (auto it = m.cbegin(); it != m.cend(); ++it) {
+    auto found = expected.find(it->first);
+    CHECK(found != expected.end() && found->second == it->second);
+    ++count;
+  }
+  CHECK(count == expected.size());
+}
+
+auto main() -> int {
+  std::mt19937 rng(0);
+  flat_hashmap<int, std::string> m;
+  std::unordered_map<int, std::string> expected;
+  for (int round = 0; round < 20; ++round) {
+    for (int i = 0; i < 500; ++i) {
+      int key = static_cast<int>(rng() % 1000);
+      if (rng() % 3 == 0) {
+        auto it = m.find(key);
+        CHECK((it != m.end()) == (expected.count(key) == 1));
+        if (it != m.end()) {
+          m.erase(it);
+          expected.erase(key);
+        }
+      } else {
+        auto value = std::to_string(key * 7 + round);
+        m[key] = value;
+        expected[key] = value;
+      }
+    }
+    CheckSame(m, expected);
+  }
+
+  // A map moved from can be copied, copy-assigned to and inserted into.
+  flat_hashmap<int, std::string> moved(std::move(m));
+  CheckSame(moved, expected);
+  CHECK(m.empty() && m.begin() == m.end() && m.count(1) == 0);  // NOLINT(bugprone-use-after-move)
+  flat_hashmap<int, std::string> copy(m);
+  CHECK(copy.empty());
+  m = moved;
+  CheckSame(m, expected);
+
+  flat_hashmap<int, std::string> other(std::move(moved));
+  moved[1] = "one";  // NOLINT(bugprone-use-after-move)
+  CHECK(moved.size() == 1 && moved.at(1) == "one");
+  flat_hashmap<int, std::string> again(std::move(moved));
+  moved.insert({2, "two"});  // NOLINT(bugprone-use-after-move)
+  CHECK(moved.size() == 1 && moved.count(2) == 1);
+  CheckSame(other, expected);
+  return 0;
+}
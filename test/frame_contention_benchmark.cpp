@@ -0,0 +1,116 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include "storage/index/b_plus_tree.h"
+
+// Contention on the control blocks of hot frames under NUM_THREADS threads.
+//
+// The first part has every thread pin and unpin the same NUM_HOT frames in turn, the frames lying next to each other
+// like the hot inner pages of a tree do in the metadata array, once with control blocks packed as Page was before it
+// was aligned to cache lines and once padded like Page is now. Packed, a pin also invalidates the line of its
+// neighbours. The second part runs point lookups on a tree with swizzling on and no resident levels, where every
+// lookup pins its inner pages through FetchChild()'s compare-and-swap on the pin count, as a reference.
+const int NUM_THREADS = 16;
+const int NUM_HOT = 8;
+const int NUM_PINS = 500000;
+const int NUM_KEYS = 100000;
+const int NUM_LOOKUPS = 200000;
+
+/** The fields of Page, without its alignment. */
+struct PackedFrame {
+  char *data_;
+  CrazyDave::page_id_t page_id_;
+  CrazyDave::file_id_t file_id_;
+  std::atomic<int> pin_count_;
+  std::atomic<bool> is_dirty_;
+  bool evicting_;
+  bool io_pending_;
+  CrazyDave::frame_id_t swizzle_parent_;
+  uint32_t swizzle_offset_;
+  CrazyDave::frame_id_t swizzle_head_;
+  CrazyDave::frame_id_t swizzle_prev_;
+  CrazyDave::frame_id_t swizzle_next_;
+};
+
+struct alignas(CrazyDave::CACHE_LINE_SIZE) PaddedFrame : PackedFrame {};
+
+static_assert(alignof(PaddedFrame) == alignof(CrazyDave::Page));
+
+template <class Frame>
+void RunPins(const char *name) {
+  auto *frames = new Frame[NUM_HOT]();
+  CrazyDave::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < NUM_THREADS; ++t) {
+    threads.push_back(std::thread([frames, t] {
+      for (int i = 0; i < NUM_PINS; ++i) {
+        auto &frame = frames[(t + i) % NUM_HOT];
+        // Pin like BufferPoolManager::TryPin(), unpin like UnpinFrame().
+        int pins = frame.pin_count_.load(std::memory_order_relaxed);
+        while (!frame.pin_count_.compare_exchange_weak(pins, pins + 1, std::memory_order_acquire,
+                                                       std::memory_order_relaxed)) {
+        }
+        frame.pin_count_.fetch_sub(1, std::memory_order_release);
+      }
+    }));
+  }
+  for (size_t t = 0; t < threads.size(); ++t) {
+    threads[t].join();
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "  " << name << " (" << sizeof(Frame) << " bytes): "
+            << elapsed / NUM_PINS << " ns/pin per thread\n";
+  delete[] frames;
+}
+
+/** Remove the files of the benchmark tree, left over by an earlier run or by this one. */
+void RemoveFiles() {
+  for (const char *suffix : {"_dt", "_gb", "_hot"}) {
+    std::remove((std::string("frame_contention_benchmark") + suffix).c_str());
+  }
+}
+
+void RunLookups() {
+  using Tree = CrazyDave::BPT<CrazyDave::String<65>, int>;
+  RemoveFiles();
+  auto *tree = new Tree("frame_contention_benchmark", 0, 4096, CrazyDave::LRUK_REPLACER_K);
+  tree->EnablePointerSwizzling(true);
+  tree->SetResidentLevels(0);
+  for (int i = 0; i < NUM_KEYS; ++i) {
+    tree->insert(CrazyDave::String<65>("key" + std::to_string(i)), i);
+  }
+  CrazyDave::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < NUM_THREADS; ++t) {
+    threads.push_back(std::thread([tree, t] {
+      std::mt19937 rng(t);
+      std::uniform_int_distribution<int> any(0, NUM_KEYS - 1);
+      CrazyDave::vector<int> result;
+      for (int i = 0; i < NUM_LOOKUPS; ++i) {
+        result.clear();
+        tree->find(CrazyDave::String<65>("key" + std::to_string(any(rng))), result);
+      }
+    }));
+  }
+  for (size_t t = 0; t < threads.size(); ++t) {
+    threads[t].join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "  " << static_cast<double>(NUM_LOOKUPS) * NUM_THREADS / elapsed / 1e6 << " M lookups/s, "
+            << tree->GetStats().pool_.swizzled_hits_ << " swizzled hits\n";
+  delete tree;
+  RemoveFiles();
+}
+
+auto main() -> int {
+  std::cout << "pins of " << NUM_HOT << " adjacent hot frames, " << NUM_THREADS << " threads\n";
+  RunPins<PackedFrame>("packed");
+  RunPins<PaddedFrame>("padded");
+  std::cout << "point lookups through hot inner pages, " << NUM_THREADS << " threads\n";
+  RunLookups();
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include <chrono>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "storage/index/b_plus_tree.h"
+
+// Tree operations with the buffer pool almost out of frames: each either happens or fails and leaves the tree as it
+// was. The frames are taken by pages of a second file of the pool.
+
+using CrazyDave::BufferPoolManager;
+using CrazyDave::page_id_t;
+using Key = CrazyDave::String<65>;
+using Tree = CrazyDave::BPT<Key, int>;
+
+const char *const NAME = "frame_exhaustion_test";
+const char *const HOG_NAME = "frame_exhaustion_test_hog";
+const size_t POOL_SIZE = 64;
+const int NUM_KEYS = 3000;
+
+void RemoveFiles() {
+  for (const char *name : {NAME, HOG_NAME}) {
+    for (const char *suffix : {"_dt", "_gb", "_hot"}) {
+      std::remove((std::string(name) + suffix).c_str());
+    }
+  }
+}
+
+auto MakeKey(int key) -> Key { return Key("key" + std::to_string(key)); }
+
+auto main() -> int {
+  RemoveFiles();
+  {
+    BufferPoolManager bpm(POOL_SIZE);
+    bpm.SetFrameWaitTimeout(std::chrono::milliseconds(0));
+    auto hog = bpm.OpenFile(HOG_NAME);
+    // Small pages, so that splits and merges reach up several levels.
+    Tree tree(NAME, 0, &bpm, 8, 8);
+    std::mt19937 rng(0);
+    std::set<int> expected;
+    std::vector<page_id_t> hogged;
+    auto release = [&](size_t count) {
+      for (; count > 0 && !hogged.empty(); --count) {
+        CHECK(bpm.UnpinPage(hogged.back(), false, hog));
+        CHECK(bpm.DeletePage(hogged.back(), hog));
+        hogged.pop_back();
+      }
+    };
+    size_t failures = 0;
+    for (int round = 0; round < 300; ++round) {
+      // Pin every frame, then leave a few of them to the tree.
+      page_id_t page_id;
+      while (bpm.NewPage(&page_id, hog) != nullptr) {
+        hogged.push_back(page_id);
+      }
+      release(rng() % 6);
+      for (int i = 0; i < 50; ++i) {
+        int key = static_cast<int>(rng() % NUM_KEYS);
+        if (rng() % 3 == 0) {
+          if (tree.remove(MakeKey(key), key)) {
+            expected.erase(key);
+          } else {
+            ++failures;
+          }
+        } else {
+          if (tree.insert(MakeKey(key), key)) {
+            expected.insert(key);
+          } else {
+            ++failures;
+          }
+        }
+      }
+      release(hogged.size());
+    }
+    CHECK(failures > 0);
+
+    CrazyDave::vector<int> result;
+    for (int key = 0; key < NUM_KEYS; ++key) {
+      result.clear();
+      CHECK(tree.find(MakeKey(key), result));
+      CHECK(result.size() == expected.count(key));
+      CHECK(result.empty() || result[0] == key);
+    }
+    {
+      // A second scan keeps the first leaf pinned, so the one stepping past it finds no frame for the next leaf and
+      // stops there.
+      auto it = tree.Begin();
+      auto other = tree.Begin();
+      page_id_t page_id;
+      while (bpm.NewPage(&page_id, hog) != nullptr) {
+        hogged.push_back(page_id);
+      }
+      size_t count = 0;
+      for (; !it.IsEnd(); ++it) {
+        ++count;
+      }
+      CHECK(it.IsFailed() && count > 0 && count < expected.size());
+      CHECK(!other.IsEnd() && !other.IsFailed());
+      release(hogged.size());
+    }
+    std::set<int> scanned;
+    for (auto it = tree.Begin(); !it.IsEnd(); ++it) {
+      CHECK(scanned.insert((*it).first.second).second);
+    }
+    CHECK(scanned == expected);
+    CHECK(!tree.IsEmpty());
+  }
+  RemoveFiles();
+  return 0;
+}
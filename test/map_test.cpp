@@ -0,0 +1,69 @@
+#include <map>
+#include <random>
+#include <string>
+#include "check.h"
+#include "data_structures/map.h"
+
+// Random inserts and erases on the pooled map, checked against std::map after every round.
+
+using CrazyDave::map;
+
+void CheckSame(map<int, std::string> &m, const std::map<int, std::string> &expected) {
+  CHECK(m.size() == expected.size());
+  auto it = m.begin();
+  for (auto &[key, value] : expected) {
+    CHECK(it != m.end());
+    CHECK(it->first == key && it->second == value);
+    ++it;
+  }
+  CHECK(it == m.end());
+}
+
+auto main() -> int {
+  std::mt19937 rng(0);
+  map<int, std::string> m;
+  std::map<int, std::string> expected;
+  for (int round = 0; round < 20; ++round) {
+    for (int i = 0; i < 500; ++i) {
+      int key = static_cast<int>(rng() % 1000);
+      if (rng() % 3 == 0) {
+        auto it = m.find(key);
+        CHECK((it != m.end()) == (expected.count(key) == 1));
+        if (it != m.end()) {
+          m.erase(it);
+          expected.erase(key);
+        }
+      } else {
+        auto value = std::to_string(key * 7 + round);
+        auto [it, inserted] = m.insert({key, value});
+        CHECK(inserted == (expected.count(key) == 0));
+        if (inserted) {
+          expected[key] = value;
+        } else {
+          CHECK(it->second == expected[key]);
+          m[key] = value;
+          expected[key] = value;
+        }
+      }
+    }
+    CheckSame(m, expected);
+  }
+
+  map<int, std::string> copy(m);
+  CheckSame(copy, expected);
+  copy.clear();
+  CHECK(copy.empty() && copy.begin() == copy.end());
+  copy = m;
+  CheckSame(copy, expected);
+
+  // Erase everything, so that every node goes back to the pool, and refill from it.
+  while (!m.empty()) {
+    m.erase(m.begin());
+  }
+  for (int key = 0; key < 1000; ++key) {
+    m[key] = std::to_string(key);
+  }
+  CHECK(m.size() == 1000 && m.at(999) == "999" && m.count(1000) == 0);
+  CheckSame(copy, expected);
+  return 0;
+}
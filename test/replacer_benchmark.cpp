@@ -0,0 +1,88 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include "buffer/arc_replacer.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "data_structures/flat_hashmap.h"
+#include "data_structures/vector.h"
+
+// Hit ratio of each replacement policy on page traces, replayed against a pool of POOL_SIZE frames the way
+// BufferPoolManager::FetchPage() uses its replacer: a miss takes a free frame or evicts the replacer's victim.
+const int POOL_SIZE = 512;
+const int NUM_PAGES = 16384;
+const int NUM_ACCESSES = 1000000;
+
+struct Access {
+  int page_id_;
+  CrazyDave::AccessType type_;
+};
+
+void Run(const char *name, CrazyDave::Replacer *replacer, const CrazyDave::vector<Access> &trace) {
+  CrazyDave::flat_hashmap<int, int> page_table;
+  CrazyDave::vector<int> resident;
+  size_t hits = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < trace.size(); ++i) {
+    auto [page_id, type] = trace[i];
+    auto it = page_table.find(page_id);
+    if (it != page_table.end()) {
+      ++hits;
+      replacer->RecordAccess(it->second, type, page_id);
+      continue;
+    }
+    int frame_id;
+    if (resident.size() < POOL_SIZE) {
+      frame_id = static_cast<int>(resident.size());
+      resident.push_back(page_id);
+    } else {
+      replacer->Evict(&frame_id);
+      page_table.erase(page_table.find(resident[frame_id]));
+      resident[frame_id] = page_id;
+    }
+    page_table[page_id] = frame_id;
+    replacer->RecordAccess(frame_id, type, page_id);
+    replacer->SetEvictable(frame_id, true);
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "  " << name << ": hit ratio " << static_cast<double>(hits) / static_cast<double>(trace.size())
+            << ", " << elapsed / static_cast<double>(trace.size()) << " ns/access\n";
+  delete replacer;
+}
+
+void RunAll(const char *workload, const CrazyDave::vector<Access> &trace) {
+  std::cout << workload << "\n";
+  Run("LRU-K", new CrazyDave::LRUKReplacer{POOL_SIZE, CrazyDave::LRUK_REPLACER_K}, trace);
+  Run("Clock", new CrazyDave::ClockReplacer{POOL_SIZE}, trace);
+  Run("ARC  ", new CrazyDave::ARCReplacer{POOL_SIZE}, trace);
+}
+
+auto main() -> int {
+  using CrazyDave::AccessType;
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> coin(0, 9);
+  std::uniform_int_distribution<int> any(0, NUM_PAGES - 1);
+  // Hot set a bit larger than the pool, so the policies have to pick which part of it stays.
+  std::uniform_int_distribution<int> hot(0, POOL_SIZE * 3 / 2 - 1);
+
+  // Point lookups, 90% of them to the hot set.
+  CrazyDave::vector<Access> skewed;
+  for (int i = 0; i < NUM_ACCESSES; ++i) {
+    skewed.push_back({coin(rng) != 0 ? hot(rng) : any(rng), AccessType::Lookup});
+  }
+  RunAll("skewed lookups", skewed);
+
+  // The same lookups, interrupted by range scans over cold pages every 25000 accesses.
+  CrazyDave::vector<Access> scans;
+  for (int i = 0, scan_page = NUM_PAGES / 2; i < NUM_ACCESSES; ++i) {
+    if (i % 25000 == 0) {
+      for (int j = 0; j < POOL_SIZE * 2; ++j) {
+        scans.push_back({scan_page, AccessType::Scan});
+        scan_page = scan_page + 1 == NUM_PAGES ? NUM_PAGES / 2 : scan_page + 1;
+      }
+    }
+    scans.push_back({coin(rng) != 0 ? hot(rng) : any(rng), AccessType::Lookup});
+  }
+  RunAll("skewed lookups with scans", scans);
+  return 0;
+}
@@ -0,0 +1,146 @@
+#include "buffer/arc_replacer.h"
+#include "buffer/clock_replacer.h"
+#include "check.h"
+
+// Victim order, scan resistance and ghost adaptation of the Clock and ARC replacers.
+
+using CrazyDave::AccessType;
+using CrazyDave::ARCReplacer;
+using CrazyDave::ClockReplacer;
+using CrazyDave::frame_id_t;
+using CrazyDave::Replacer;
+
+/** Track frames [0, count) as holding pages 100 + frame id, in frame order, and make them evictable. */
+void Fill(Replacer &replacer, int count, AccessType access_type = AccessType::Unknown) {
+  for (frame_id_t fid = 0; fid < count; ++fid) {
+    replacer.RecordAccess(fid, access_type, 100 + fid);
+    replacer.SetEvictable(fid, true);
+  }
+}
+
+/** @return the next victim, -1 if there is none */
+auto Victim(Replacer &replacer) -> frame_id_t {
+  frame_id_t fid;
+  return replacer.Evict(&fid) ? fid : -1;
+}
+
+void TestClock() {
+  {
+    // Unreferenced frames go in the order the hand reaches them.
+    ClockReplacer clock(4);
+    Fill(clock, 4);
+    CHECK(clock.Size() == 4);
+    for (frame_id_t fid = 0; fid < 4; ++fid) {
+      CHECK(Victim(clock) == fid);
+    }
+    CHECK(Victim(clock) == -1 && clock.Size() == 0);
+  }
+  {
+    // A referenced frame gets a second chance, a pinned one is skipped.
+    ClockReplacer clock(4);
+    Fill(clock, 4);
+    clock.RecordAccess(1, AccessType::Lookup);
+    clock.RecordAccess(2, AccessType::Lookup);
+    clock.SetEvictable(3, false);
+    CHECK(Victim(clock) == 0);
+    CHECK(Victim(clock) == 1);
+    CHECK(Victim(clock) == 2);
+    CHECK(Victim(clock) == -1);
+    clock.SetEvictable(3, true);
+    CHECK(Victim(clock) == 3);
+  }
+  {
+    // Scan accesses never set the reference bit, so frames touched by a scan go before the working set.
+    ClockReplacer clock(4);
+    Fill(clock, 2);
+    clock.RecordAccess(0, AccessType::Lookup);
+    clock.RecordAccess(1, AccessType::Lookup);
+    for (frame_id_t fid = 2; fid < 4; ++fid) {
+      clock.RecordAccess(fid, AccessType::Scan, 100 + fid);
+      clock.RecordAccess(fid, AccessType::Scan, 100 + fid);
+      clock.SetEvictable(fid, true);
+    }
+    CHECK(Victim(clock) == 2);
+    CHECK(Victim(clock) == 3);
+  }
+  {
+    // The filter passed to Evict() replaces the evictable marks.
+    ClockReplacer clock(4);
+    Fill(clock, 4);
+    frame_id_t fid;
+    CHECK(clock.Evict(&fid, [](frame_id_t f) { return f == 2; }) && fid == 2);
+  }
+}
+
+void TestARC() {
+  {
+    // Pages seen once leave in LRU order, before pages seen twice.
+    ARCReplacer arc(4);
+    Fill(arc, 4);
+    arc.RecordAccess(0, AccessType::Lookup, 100);
+    arc.RecordAccess(1, AccessType::Lookup, 101);
+    CHECK(Victim(arc) == 2);
+    CHECK(Victim(arc) == 3);
+    CHECK(Victim(arc) == 0);
+    CHECK(Victim(arc) == 1);
+    CHECK(Victim(arc) == -1);
+  }
+  {
+    // A second access by a scan does not promote the page.
+    ARCReplacer arc(4);
+    Fill(arc, 2);
+    arc.RecordAccess(0, AccessType::Scan, 100);
+    arc.RecordAccess(1, AccessType::Lookup, 101);
+    arc.RecordAccess(2, AccessType::Scan, 102);
+    arc.SetEvictable(2, true);
+    CHECK(Victim(arc) == 0);
+    CHECK(Victim(arc) == 2);
+    CHECK(Victim(arc) == 1);
+  }
+  {
+    // A miss on a page just evicted from T1 grows the target size of T1 and brings the page back into T2, a miss on
+    // a page evicted from T2 shrinks it again.
+    ARCReplacer arc(4);
+    Fill(arc, 4);
+    CHECK(arc.GetTarget() == 0);
+    CHECK(Victim(arc) == 0);  // page 100 goes to B1
+    arc.RecordAccess(0, AccessType::Unknown, 100);
+    arc.SetEvictable(0, true);
+    CHECK(arc.GetTarget() == 1);
+    // Only page 100 is in T2 now, T1 is at its target and goes first.
+    CHECK(Victim(arc) == 1);
+    CHECK(Victim(arc) == 2);
+    CHECK(Victim(arc) == 3);
+    CHECK(Victim(arc) == 0);  // page 100 goes to B2
+    arc.RecordAccess(0, AccessType::Unknown, 100);
+    CHECK(arc.GetTarget() == 0);
+  }
+  {
+    // Tracking an evicted frame again without its page key, as the buffer pool does when it could not claim the
+    // victim, is no ghost hit.
+    ARCReplacer arc(4);
+    Fill(arc, 4);
+    CHECK(Victim(arc) == 0);
+    arc.RecordAccess(0);
+    arc.SetEvictable(0, true);
+    CHECK(arc.GetTarget() == 0);
+    CHECK(Victim(arc) == 1);
+    CHECK(Victim(arc) == 2);
+    CHECK(Victim(arc) == 3);
+    CHECK(Victim(arc) == 0);
+  }
+  {
+    // Ghosts are keyed by file and page, the same page id in another file of the pool is no ghost hit.
+    ARCReplacer arc(4);
+    Fill(arc, 4);
+    CHECK(Victim(arc) == 0);  // page 100 of file 0 goes to B1
+    arc.RecordAccess(0, AccessType::Unknown, uint64_t{1} << 32 | 100);
+    CHECK(arc.GetTarget() == 0);
+  }
+}
+
+auto main() -> int {
+  TestClock();
+  TestARC();
+  return 0;
+}
@@ -0,0 +1,76 @@
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.h"
+#include "storage/index/b_plus_tree.h"
+
+// Lookups through the resident top levels of a tree from many threads at once. The threads race to install the same
+// pages into the resident cache, and the inner pages outnumber its slots. Every lookup must see its pair, and once the
+// resident levels are turned off again no pin may be left behind. Before that, a tree growing with only the root
+// resident must not keep its old roots pinned.
+
+using CrazyDave::BufferPoolManager;
+using Key = CrazyDave::String<65>;
+using Tree = CrazyDave::BPT<Key, int>;
+
+const char *const NAME = "resident_cache_test";
+const size_t POOL_SIZE = 1024;
+const int NUM_THREADS = 8;
+const int NUM_KEYS = 5000;
+const int NUM_LOOKUPS = 10000;
+
+void RemoveFiles() {
+  for (const char *suffix : {"_dt", "_gb", "_hot"}) {
+    std::remove((std::string(NAME) + suffix).c_str());
+  }
+}
+
+auto MakeKey(int key) -> Key { return Key("key" + std::to_string(key)); }
+
+/** @return the pins held on the frames of the pool */
+auto Pins(BufferPoolManager &bpm) -> size_t {
+  size_t pins = 0;
+  for (size_t i = 0; i < bpm.GetPoolSize(); ++i) {
+    pins += bpm.GetPages()[i].GetPinCount();
+  }
+  return pins;
+}
+
+auto main() -> int {
+  RemoveFiles();
+  {
+    BufferPoolManager bpm(POOL_SIZE);
+    // Small pages for a tall tree, with more inner pages in the resident levels than the 256 slots of the cache.
+    Tree tree(NAME, 0, &bpm, 8, 8);
+    tree.SetResidentLevels(1);
+    for (int i = 0; i < NUM_KEYS; ++i) {
+      CHECK(tree.insert(MakeKey(i), i));
+    }
+    // The header and the root, but for pins retired in the epochs.
+    CHECK(Pins(bpm) <= bpm.GetRetiredPageCount() + 2);
+    tree.SetResidentLevels(6);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NUM_THREADS; ++t) {
+      threads.emplace_back([&tree, t] {
+        std::mt19937 rng(t);
+        CrazyDave::vector<int> result;
+        for (int i = 0; i < NUM_LOOKUPS; ++i) {
+          int key = static_cast<int>(rng() % NUM_KEYS);
+          result.clear();
+          CHECK(tree.find(MakeKey(key), result));
+          CHECK(result.size() == 1 && result[0] == key);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    // The pins left are those retired in the epochs, waiting for readers that might have been using them.
+    tree.SetResidentLevels(0);
+    CHECK(Pins(bpm) == bpm.GetRetiredPageCount());
+  }
+  RemoveFiles();
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "storage/index/b_plus_tree.h"
+
+// Pointer swizzling on a tree much larger than its buffer pool. Swizzled child references live in page data, so
+// evictions, merges, root changes and turning swizzling off must all put the page ids back before a page is written
+// out. Each run reopens the files and checks every key with swizzling off, which a tagged reference on disk would
+// send to a bogus page.
+
+using Key = CrazyDave::String<65>;
+using Tree = CrazyDave::BPT<Key, int>;
+
+const char *const NAME = "swizzling_test";
+const size_t POOL_SIZE = 64;
+const int NUM_KEYS = 6000;
+
+void RemoveFiles() {
+  for (const char *suffix : {"_dt", "_gb", "_hot"}) {
+    std::remove((std::string(NAME) + suffix).c_str());
+  }
+}
+
+auto MakeKey(int key) -> Key { return Key("key" + std::to_string(key)); }
+
+void CheckKeys(Tree &tree, const std::set<int> &expected) {
+  CrazyDave::vector<int> result;
+  for (int key = 0; key < NUM_KEYS; ++key) {
+    result.clear();
+    CHECK(tree.find(MakeKey(key), result));
+    CHECK(result.size() == expected.count(key));
+    CHECK(result.empty() || result[0] == key);
+  }
+  std::set<int> scanned;
+  for (auto it = tree.Begin(); !it.IsEnd(); ++it) {
+    CHECK(scanned.insert((*it).first.second).second);
+  }
+  CHECK(scanned == expected);
+}
+
+/** Open the tree with small pages, so that it is tall and splits and merges often. */
+auto Open(bool swizzling, int resident_levels) -> Tree * {
+  auto *tree = new Tree(NAME, 0, POOL_SIZE, CrazyDave::LRUK_REPLACER_K, 8, 8);
+  tree->SetResidentLevels(resident_levels);
+  tree->EnablePointerSwizzling(swizzling);
+  return tree;
+}
+
+auto main() -> int {
+  RemoveFiles();
+  std::mt19937 rng(0);
+  std::vector<int> keys(NUM_KEYS);
+  for (int i = 0; i < NUM_KEYS; ++i) {
+    keys[i] = i;
+  }
+  std::shuffle(keys.begin(), keys.end(), rng);
+  std::set<int> expected;
+  {
+    // Swizzled from the root down. The tree grows and shrinks back to a few pages, changing its root both ways.
+    auto *tree = Open(true, 0);
+    for (int key : keys) {
+      CHECK(tree->insert(MakeKey(key), key));
+      expected.insert(key);
+    }
+    std::shuffle(keys.begin(), keys.end(), rng);
+    for (int i = 0; i < NUM_KEYS - 20; ++i) {
+      CHECK(tree->remove(MakeKey(keys[i]), keys[i]));
+      expected.erase(keys[i]);
+    }
+    for (int i = 0; i < NUM_KEYS / 2; ++i) {
+      CHECK(tree->insert(MakeKey(keys[i]), keys[i]));
+      expected.insert(keys[i]);
+    }
+    CHECK(tree->GetStats().pool_.swizzled_hits_ > 0);
+    CheckKeys(*tree, expected);
+    delete tree;
+  }
+  {
+    auto *tree = Open(false, 0);
+    CheckKeys(*tree, expected);
+    delete tree;
+  }
+  {
+    // Swizzled below the resident levels, then turned off while pages are still swizzled.
+    auto *tree = Open(true, CrazyDave::RESIDENT_LEVELS);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    for (int i = 0; i < NUM_KEYS / 2; ++i) {
+      if (expected.count(keys[i]) != 0) {
+        CHECK(tree->remove(MakeKey(keys[i]), keys[i]));
+        expected.erase(keys[i]);
+      } else {
+        CHECK(tree->insert(MakeKey(keys[i]), keys[i]));
+        expected.insert(keys[i]);
+      }
+    }
+    CheckKeys(*tree, expected);
+    tree->EnablePointerSwizzling(false);
+    CheckKeys(*tree, expected);
+    delete tree;
+  }
+  {
+    auto *tree = Open(false, 0);
+    CheckKeys(*tree, expected);
+    delete tree;
+  }
+  RemoveFiles();
+  return 0;
+}
@@ -0,0 +1,39 @@
+#include <string>
+#include <utility>
+#include "check.h"
+#include "data_structures/vector.h"
+
+// Edge cases of vector: erasing end(), and pushing back an element of the vector itself while it grows.
+
+using CrazyDave::vector;
+
+template <size_t InlineN>
+void TestPushBackSelf() {
+  vector<std::string, InlineN> v;
+  for (int i = 0; i < 8; ++i) {
+    v.push_back(std::string(32, static_cast<char>('a' + i)));
+  }
+  // Full at 8 elements, inline or on the heap, so both pushes below grow the storage.
+  v.push_back(v[0]);
+  CHECK(v.size() == 9 && v[8] == std::string(32, 'a'));
+  while (v.size() < 16) {
+    v.push_back(std::string(32, 'x'));
+  }
+  v.push_back(std::move(v[1]));
+  CHECK(v.size() == 17 && v[16] == std::string(32, 'b'));
+}
+
+auto main() -> int {
+  TestPushBackSelf<0>();
+  TestPushBackSelf<8>();
+
+  vector<int> v;
+  for (int i = 0; i < 5; ++i) {
+    v.push_back(i);
+  }
+  auto it = v.erase(v.end());
+  CHECK(it == v.end() && v.size() == 4 && v.back() == 3);
+  it = v.erase(v.begin() + 1);
+  CHECK(*it == 2 && v.size() == 3 && v[0] == 0 && v[1] == 2 && v[2] == 3);
+  return 0;
+}
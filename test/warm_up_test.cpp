@@ -0,0 +1,70 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include "check.h"
+#include "storage/index/b_plus_tree.h"
+
+// Warming up the buffer pool from the saved hot pages on reopen, and ignoring them once the data file is gone.
+// Prefetching into a pool of a couple of frames.
+
+using Key = CrazyDave::String<65>;
+using Tree = CrazyDave::BPT<Key, int>;
+
+const char *const NAME = "warm_up_test";
+const int NUM_KEYS = 50000;
+
+void RemoveFiles(std::initializer_list<const char *> suffixes) {
+  for (const char *suffix : suffixes) {
+    std::remove((std::string(NAME) + suffix).c_str());
+  }
+}
+
+void Insert(Tree &tree, int count) {
+  for (int i = 0; i < count; ++i) {
+    tree.insert(Key("key" + std::to_string(i)), i);
+  }
+}
+
+void CheckKeys(Tree &tree, int count) {
+  CrazyDave::vector<int> result;
+  for (int i = 0; i < count; ++i) {
+    result.clear();
+    tree.find(Key("key" + std::to_string(i)), result);
+    CHECK(result.size() == 1 && result[0] == i);
+  }
+}
+
+auto main() -> int {
+  RemoveFiles({"_dt", "_gb", "_hot"});
+  {
+    Tree tree(NAME, 0, 256, CrazyDave::LRUK_REPLACER_K);
+    Insert(tree, NUM_KEYS);
+  }
+  {
+    // The hot pages of the last run are read back while the tree is used.
+    Tree tree(NAME, 0, 256, CrazyDave::LRUK_REPLACER_K);
+    CheckKeys(tree, NUM_KEYS);
+  }
+  // A new data file next to the hot page list of an older one: the listed pages do not exist and must not be read
+  // into frames that new pages of the same ids are given.
+  RemoveFiles({"_dt", "_gb"});
+  {
+    Tree tree(NAME, 0, 256, CrazyDave::LRUK_REPLACER_K);
+    CHECK(tree.IsEmpty());
+    Insert(tree, NUM_KEYS);
+    CheckKeys(tree, NUM_KEYS);
+  }
+  // Pools of fewer than 4 frames prefetch too. No hot pages this time, only the page asked for is read ahead.
+  RemoveFiles({"_hot"});
+  {
+    CrazyDave::BufferPoolManager bpm(NAME, 2);
+    bpm.Prefetch(1);
+    for (int i = 0; i < 100 && bpm.GetStats().prefetched_pages_ == 0; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(bpm.GetStats().prefetched_pages_ == 1);
+  }
+  RemoveFiles({"_dt", "_gb", "_hot"});
+  return 0;
+}
@@ -0,0 +1,172 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "buffer/access_tracer.h"
+#include "buffer/arc_replacer.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "data_structures/flat_hashmap.h"
+#include "data_structures/vector.h"
+
+// Replays a page access trace recorded by BufferPoolManager::StartTrace() against every pool size and replacement
+// policy asked for, and prints the hit ratio of each.
+//
+//   replacer_simulator <trace> [-p pool_size,...] [-k k,...]
+//
+// Without -p the pool sizes are the powers of two from 16 up to the number of distinct pages of the trace. The
+// policies are LRU-K for every k given with -k (2, 4 and LRUK_REPLACER_K by default), Clock and ARC. Pages of a
+// trace of a pool shared by several files are told apart by their file id. Prefetched pages are brought in like
+// misses but do not count as accesses.
+
+using namespace CrazyDave;
+
+auto ParseList(const char *arg, vector<size_t> &out) -> bool {
+  out.clear();
+  for (const char *p = arg; *p != '\0';) {
+    char *end;
+    auto value = std::strtoul(p, &end, 10);
+    if (end == p || value == 0) {
+      return false;
+    }
+    out.push_back(value);
+    p = *end == ',' ? end + 1 : end;
+  }
+  return !out.empty();
+}
+
+auto ReadTrace(const char *path, vector<TraceRecord> &trace) -> bool {
+  std::ifstream file(path, std::ios::binary);
+  uint64_t magic = 0;
+  if (!file.read(reinterpret_cast<char *>(&magic), sizeof(magic)) || magic != TRACE_MAGIC) {
+    return false;
+  }
+  TraceRecord record;
+  while (file.read(reinterpret_cast<char *>(&record), sizeof(record))) {
+    trace.push_back(record);
+  }
+  return true;
+}
+
+/** @return the key of the page of a record, unique across the files of the traced pool */
+auto PageKey(const TraceRecord &record) -> uint64_t {
+  return static_cast<uint64_t>(record.file_id_) << 32 | static_cast<uint32_t>(record.page_id_);
+}
+
+/** @return the hit ratio of the replacer on the trace with a pool of pool_size frames */
+auto Replay(Replacer *replacer, size_t pool_size, const vector<TraceRecord> &trace) -> double {
+  flat_hashmap<uint64_t, frame_id_t> page_table(pool_size);
+  vector<uint64_t> frames;
+  vector<frame_id_t> free_frames;
+  size_t hits = 0;
+  size_t accesses = 0;
+  for (size_t i = 0; i < trace.size(); ++i) {
+    auto &record = trace[i];
+    auto key = PageKey(record);
+    auto it = page_table.find(key);
+    if (record.event_ == TraceEvent::Delete) {
+      if (it != page_table.end()) {
+        replacer->Remove(it->second);
+        free_frames.push_back(it->second);
+        page_table.erase(it);
+      }
+      continue;
+    }
+    auto access_type = static_cast<AccessType>(record.access_type_);
+    // A prefetch brings the page in like a miss, but is no access of its own.
+    bool prefetch = record.event_ == TraceEvent::Prefetch;
+    accesses += !prefetch;
+    if (it != page_table.end()) {
+      if (!prefetch) {
+        ++hits;
+        replacer->RecordAccess(it->second, access_type, key);
+      }
+      continue;
+    }
+    frame_id_t fid;
+    if (!free_frames.empty()) {
+      fid = free_frames.back();
+      free_frames.pop_back();
+      frames[fid] = key;
+    } else if (frames.size() < pool_size) {
+      fid = static_cast<frame_id_t>(frames.size());
+      frames.push_back(key);
+    } else {
+      replacer->Evict(&fid);
+      page_table.erase(page_table.find(frames[fid]));
+      frames[fid] = key;
+    }
+    page_table[key] = fid;
+    replacer->RecordAccess(fid, access_type, key);
+    replacer->SetEvictable(fid, true);
+  }
+  delete replacer;
+  return accesses == 0 ? 0 : static_cast<double>(hits) / static_cast<double>(accesses);
+}
+
+auto main(int argc, char **argv) -> int {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " <trace> [-p pool_size,...] [-k k,...]\n";
+    return 1;
+  }
+  vector<size_t> pool_sizes;
+  vector<size_t> ks;
+  ks.push_back(2);
+  ks.push_back(4);
+  ks.push_back(LRUK_REPLACER_K);
+  for (int i = 2; i < argc; i += 2) {
+    bool ok = i + 1 < argc;
+    if (ok && std::strcmp(argv[i], "-p") == 0) {
+      ok = ParseList(argv[i + 1], pool_sizes);
+    } else if (ok && std::strcmp(argv[i], "-k") == 0) {
+      ok = ParseList(argv[i + 1], ks);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      std::cerr << "bad argument " << argv[i] << "\n";
+      return 1;
+    }
+  }
+
+  vector<TraceRecord> trace;
+  if (!ReadTrace(argv[1], trace)) {
+    std::cerr << argv[1] << " is not an access trace\n";
+    return 1;
+  }
+  flat_hashmap<uint64_t, bool> distinct;
+  size_t accesses = 0;
+  size_t hits = 0;
+  for (size_t i = 0; i < trace.size(); ++i) {
+    if (trace[i].event_ != TraceEvent::Delete) {
+      distinct[PageKey(trace[i])] = true;
+      accesses += trace[i].event_ != TraceEvent::Prefetch;
+      hits += trace[i].event_ == TraceEvent::Hit;
+    }
+  }
+  std::cout << accesses << " accesses to " << distinct.size() << " pages, recorded hit ratio "
+            << (accesses == 0 ? 0 : static_cast<double>(hits) / static_cast<double>(accesses)) << "\n";
+  if (pool_sizes.empty()) {
+    for (size_t pool_size = 16; pool_size < distinct.size() * 2; pool_size *= 2) {
+      pool_sizes.push_back(pool_size);
+    }
+  }
+
+  std::cout << std::setw(10) << "pool";
+  for (size_t i = 0; i < ks.size(); ++i) {
+    std::cout << std::setw(10) << "LRU-" + std::to_string(ks[i]);
+  }
+  std::cout << std::setw(10) << "Clock" << std::setw(10) << "ARC" << "\n" << std::fixed << std::setprecision(4);
+  for (size_t i = 0; i < pool_sizes.size(); ++i) {
+    auto pool_size = pool_sizes[i];
+    std::cout << std::setw(10) << pool_size;
+    for (size_t j = 0; j < ks.size(); ++j) {
+      std::cout << std::setw(10) << Replay(new LRUKReplacer{pool_size, ks[j]}, pool_size, trace);
+    }
+    std::cout << std::setw(10) << Replay(new ClockReplacer{pool_size}, pool_size, trace);
+    std::cout << std::setw(10) << Replay(new ARCReplacer{pool_size}, pool_size, trace) << "\n" << std::flush;
+  }
+  return 0;
+}